@@ -0,0 +1,298 @@
+#include "Batch.h"
+#include "BoundedQueue.h"
+#include "GrayscaleImage.h"
+#include "Filter.h"
+#include "Convolution.h"
+#include "FileNames.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace {
+
+// A single file travelling through the pipeline
+struct BatchJob {
+    std::string input;
+    std::string output;
+    GrayscaleImage* image;
+};
+
+// Operation applied by the filter stage and the output filename it produces
+struct BatchOperation {
+    std::function<void(GrayscaleImage&)> apply;
+    std::function<std::string(const std::string&)> output_name;
+};
+
+bool is_directory(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+bool has_image_extension(const std::string& name) {
+    size_t last_dot = name.find_last_of(".");
+    if (last_dot == std::string::npos) {
+        return false;
+    }
+    std::string extension = name.substr(last_dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    static const char* supported[] = {"png", "jpg", "jpeg", "bmp", "tga", "gif", "pgm", "ppm", "psd", "hdr"};
+    for (const char* candidate : supported) {
+        if (extension == candidate) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Builds the operation for the given name and arguments, mirroring the single file commands
+BatchOperation make_operation(const std::string& operation, const std::vector<std::string>& args) {
+    BatchOperation op;
+    if (operation == "mean") {
+        int kernel_size = std::stoi(args[0]);
+        op.apply = [kernel_size](GrayscaleImage& img) { Filter::apply_mean_filter(img, kernel_size); };
+        op.output_name = [kernel_size](const std::string& stem) {
+            return "mean_filtered_" + stem + "_" + std::to_string(kernel_size) + ".png";
+        };
+    } else if (operation == "gauss") {
+        int kernel_size = std::stoi(args[0]);
+        double sigma = std::stof(args[1]);
+        op.apply = [kernel_size, sigma](GrayscaleImage& img) { Filter::apply_gaussian_smoothing(img, kernel_size, sigma); };
+        op.output_name = [kernel_size, sigma](const std::string& stem) {
+            return "gaussian_filtered_" + stem + "_" + std::to_string(kernel_size) + "_" + std::to_string(sigma) + ".png";
+        };
+    } else if (operation == "unsharp") {
+        int kernel_size = std::stoi(args[0]);
+        double amount = std::stof(args[1]);
+        op.apply = [kernel_size, amount](GrayscaleImage& img) { Filter::apply_unsharp_mask(img, kernel_size, amount); };
+        op.output_name = [kernel_size, amount](const std::string& stem) {
+            return "unsharp_filtered_" + stem + "_" + std::to_string(kernel_size) + "_" + std::to_string(amount) + ".png";
+        };
+    } else if (operation == "median") {
+        int kernel_size = std::stoi(args[0]);
+        op.apply = [kernel_size](GrayscaleImage& img) { Filter::apply_median_filter(img, kernel_size); };
+        op.output_name = [kernel_size](const std::string& stem) {
+            return "median_filtered_" + stem + "_" + std::to_string(kernel_size) + ".png";
+        };
+    } else if (operation == "bilateral") {
+        double spatial_sigma = std::stof(args[0]);
+        double range_sigma = std::stof(args[1]);
+        op.apply = [spatial_sigma, range_sigma](GrayscaleImage& img) { Filter::apply_bilateral_filter(img, spatial_sigma, range_sigma); };
+        op.output_name = [spatial_sigma, range_sigma](const std::string& stem) {
+            return "bilateral_filtered_" + stem + "_" + std::to_string(spatial_sigma) + "_" + std::to_string(range_sigma) + ".png";
+        };
+    } else if (operation == "erode" || operation == "dilate" || operation == "open" || operation == "close" || operation == "gradient") {
+        int element_width = std::stoi(args[0]);
+        int element_height = (args.size() > 1) ? std::stoi(args[1]) : element_width;
+        void (*morphology)(GrayscaleImage&, int, int) =
+            operation == "erode" ? Filter::apply_erosion :
+            operation == "dilate" ? Filter::apply_dilation :
+            operation == "open" ? Filter::apply_opening :
+            operation == "close" ? Filter::apply_closing : Filter::apply_morphological_gradient;
+        op.apply = [morphology, element_width, element_height](GrayscaleImage& img) { morphology(img, element_width, element_height); };
+        op.output_name = [operation, element_width, element_height](const std::string& stem) {
+            return operation + "_filtered_" + stem + "_" + std::to_string(element_width) + "x" + std::to_string(element_height) + ".png";
+        };
+    } else {
+        throw std::invalid_argument("Unsupported batch operation: " + operation);
+    }
+    return op;
+}
+
+} // namespace
+
+// Default configuration: keep the filter stage busy on every hardware thread
+Batch::Options::Options() : decode_workers(2), filter_workers(1), encode_workers(2), queue_capacity(8) {
+    unsigned int hardware_threads = std::thread::hardware_concurrency();
+    if (hardware_threads > 0) {
+        filter_workers = (int)hardware_threads;
+        queue_capacity = 2 * (int)hardware_threads;
+    }
+}
+
+// Number of arguments each batch operation takes before the input paths
+int Batch::argument_count(const std::string& operation) {
+    if (operation == "mean") return 1;
+    if (operation == "gauss") return 2;
+    if (operation == "unsharp") return 2;
+    if (operation == "median") return 1;
+    if (operation == "bilateral") return 2;
+    if (operation == "erode" || operation == "dilate" || operation == "open" || operation == "close" || operation == "gradient") return 1;
+    return -1;
+}
+
+// Only the morphology operations have an optional argument, the element height
+int Batch::optional_argument_count(const std::string& operation) {
+    if (operation == "erode" || operation == "dilate" || operation == "open" || operation == "close" || operation == "gradient") return 1;
+    return 0;
+}
+
+// Expand directories (non-recursively) and "@list.txt" files into image paths
+std::vector<std::string> Batch::collect_inputs(const std::vector<std::string>& paths) {
+    std::vector<std::string> inputs;
+    for (const std::string& path : paths) {
+        if (!path.empty() && path[0] == '@') {
+            std::ifstream list_file(path.substr(1));
+            if (list_file.is_open() == false) {
+                throw std::runtime_error("Can't open the file list " + path.substr(1));
+            }
+            std::string line;
+            while (std::getline(list_file, line)) {
+                if (!line.empty() && line[line.size() - 1] == '\r') {
+                    line.erase(line.size() - 1);
+                }
+                if (!line.empty()) {
+                    inputs.push_back(line);
+                }
+            }
+        } else if (is_directory(path)) {
+            DIR* dir = opendir(path.c_str());
+            if (dir == nullptr) {
+                throw std::runtime_error("Can't open the directory " + path);
+            }
+            std::vector<std::string> entries;
+            std::string prefix = (path[path.size() - 1] == '/') ? path : path + "/";
+            while (struct dirent* entry = readdir(dir)) {
+                std::string name = entry->d_name;
+                if (name[0] != '.' && has_image_extension(name) && !is_directory(prefix + name)) {
+                    entries.push_back(prefix + name);
+                }
+            }
+            closedir(dir);
+            // Directory order is arbitrary, sort for reproducible runs
+            std::sort(entries.begin(), entries.end());
+            inputs.insert(inputs.end(), entries.begin(), entries.end());
+        } else {
+            inputs.push_back(path);
+        }
+    }
+    return inputs;
+}
+
+// Run decode, operation and encode as concurrent stages connected by bounded queues
+void Batch::run(const std::string& operation, const std::vector<std::string>& args,
+                const std::vector<std::string>& inputs, const Options& options) {
+    int required = argument_count(operation);
+    if (required < 0 || (int)args.size() < required || (int)args.size() > required + optional_argument_count(operation)) {
+        throw std::invalid_argument("Invalid arguments for batch operation: " + operation);
+    }
+    BatchOperation op = make_operation(operation, args);
+
+    // Outputs land in one directory under the input's base name, so inputs sharing a
+    // base name (a/x.png and b/x.png) would overwrite each other's result
+    std::map<std::string, std::string> output_owner;
+    for (const std::string& input : inputs) {
+        std::string output = op.output_name(output_stem(input));
+        auto inserted = output_owner.insert(std::make_pair(output, input));
+        if (!inserted.second) {
+            throw std::invalid_argument("Inputs " + inserted.first->second + " and " + input +
+                                        " would both be written to " + output);
+        }
+    }
+
+    int decode_workers = std::max(1, options.decode_workers);
+    int filter_workers = std::max(1, options.filter_workers);
+    int encode_workers = std::max(1, options.encode_workers);
+
+    BoundedQueue<BatchJob*> decoded(std::max(1, options.queue_capacity));
+    BoundedQueue<BatchJob*> filtered(std::max(1, options.queue_capacity));
+
+    std::atomic<size_t> next_input(0);
+    std::atomic<int> decoders_left(decode_workers);
+    std::atomic<int> filters_left(filter_workers);
+    std::atomic<size_t> completed(0);
+
+    std::mutex error_mutex;
+    std::vector<std::string> errors;
+    auto record_error = [&](BatchJob* job, const std::string& message) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        errors.push_back(job->input + ": " + message);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+
+    // 1. Decode stage: claims input files in order and loads them
+    auto decode_stage = [&]() {
+        size_t index;
+        while ((index = next_input++) < inputs.size()) {
+            BatchJob* job = new BatchJob();
+            job->input = inputs[index];
+            job->output = op.output_name(output_stem(job->input));
+            try {
+                job->image = new GrayscaleImage(GrayscaleImage::load(job->input.c_str()));
+            } catch (const std::exception& e) {
+                // A file that can't be decoded is reported and skipped, the others go on
+                record_error(job, e.what());
+                delete job;
+                continue;
+            }
+            decoded.push(job);
+        }
+        // The last decoder to finish lets the filter stage drain and stop
+        if (--decoders_left == 0) {
+            decoded.close();
+        }
+    };
+
+    // 2. Filter stage: applies the operation in place
+    auto filter_stage = [&]() {
+        // The filter workers already run side by side, each one only gets its share of the convolution threads
+        Convolution::ThreadBudget budget(Convolution::shared_thread_budget(filter_workers));
+        BatchJob* job;
+        while (decoded.pop(job)) {
+            try {
+                op.apply(*job->image);
+                filtered.push(job);
+            } catch (const std::exception& e) {
+                record_error(job, e.what());
+                delete job->image;
+                delete job;
+            }
+        }
+        if (--filters_left == 0) {
+            filtered.close();
+        }
+    };
+
+    // 3. Encode stage: writes the result and releases the image
+    auto encode_stage = [&]() {
+        BatchJob* job;
+        while (filtered.pop(job)) {
+            try {
+                job->image->save(job->output.c_str());
+                completed++;
+            } catch (const std::exception& e) {
+                record_error(job, e.what());
+            }
+            delete job->image;
+            delete job;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < decode_workers; i++) workers.push_back(std::thread(decode_stage));
+    for (int i = 0; i < filter_workers; i++) workers.push_back(std::thread(filter_stage));
+    for (int i = 0; i < encode_workers; i++) workers.push_back(std::thread(encode_stage));
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Processed " << completed << " of " << inputs.size() << " images in " << seconds << " s." << std::endl;
+
+    if (!errors.empty()) {
+        for (const std::string& error : errors) {
+            std::cerr << "Error: " << error << std::endl;
+        }
+        throw std::runtime_error("Batch finished with " + std::to_string(errors.size()) + " failed images.");
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include <vector>
+
+// Runs one operation over many image files as a three stage pipeline:
+// decode -> operation -> encode, with bounded queues between the stages
+// so decoding and encoding overlap with filtering.
+class Batch {
+public:
+    // Worker and queue configuration of the pipeline
+    struct Options {
+        int decode_workers;
+        int filter_workers;
+        int encode_workers;
+        int queue_capacity;
+
+        // Defaults scale the filter stage with the number of hardware threads
+        Options();
+    };
+
+    // Number of operation arguments expected after the operation name, or -1 if unsupported
+    static int argument_count(const std::string& operation);
+
+    // Number of further numeric arguments the operation may take after the required ones
+    // (the morphology element height, which defaults to its width)
+    static int optional_argument_count(const std::string& operation);
+
+    // Expands directories and @list files into the list of image files to process
+    static std::vector<std::string> collect_inputs(const std::vector<std::string>& paths);
+
+    // Applies the operation to every input and writes each result into the working directory
+    // using the same output filename convention as the single file operations.
+    static void run(const std::string& operation, const std::vector<std::string>& args,
+                    const std::vector<std::string>& inputs, const Options& options);
+};
+
+#endif // BATCH_H
@@ -0,0 +1,59 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+// Fixed-capacity blocking queue used to connect pipeline stages.
+// push() blocks while the queue is full, pop() blocks while it is empty.
+// Once close() is called, pop() drains the remaining items and then returns false.
+template <typename T>
+class BoundedQueue {
+private:
+    std::deque<T> items;
+    std::size_t capacity;
+    bool closed;
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+
+public:
+    explicit BoundedQueue(std::size_t cap) : capacity(cap > 0 ? cap : 1), closed(false) {}
+
+    // Adds an item, waiting for room. Returns false if the queue was closed.
+    bool push(const T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [this] { return closed || items.size() < capacity; });
+        if (closed) {
+            return false;
+        }
+        items.push_back(item);
+        not_empty.notify_one();
+        return true;
+    }
+
+    // Removes the oldest item, waiting for one. Returns false once closed and drained.
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [this] { return closed || !items.empty(); });
+        if (items.empty()) {
+            return false;
+        }
+        item = items.front();
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    // Signals that no more items will be pushed and wakes every waiter.
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+};
+
+#endif // BOUNDED_QUEUE_H
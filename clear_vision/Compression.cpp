@@ -0,0 +1,163 @@
+#include "Compression.h"
+#include <cstdint>
+#include <stdexcept>
+
+namespace {
+
+const int PROBABILITY_BITS = 11;
+const uint32_t PROBABILITY_ONE = 1u << PROBABILITY_BITS;
+const int ADAPTATION_SHIFT = 5;
+const uint32_t TOP = 1u << 24;
+
+// Residual models are selected by the size of the previous residual: flat areas, soft gradients, edges
+const int CONTEXTS = 3;
+
+int context_of(int residual) {
+    int magnitude = (residual < 128) ? residual : 256 - residual;
+    if (magnitude == 0) return 0;
+    return magnitude < 8 ? 1 : 2;
+}
+
+// Binary range encoder with carry propagation
+class RangeEncoder {
+private:
+    std::vector<unsigned char>& output;
+    uint64_t low;
+    uint32_t range;
+    unsigned char cache;
+    uint64_t cache_size;
+
+    void shift_low() {
+        if ((uint32_t)low < 0xFF000000u || (low >> 32) != 0) {
+            unsigned char carry = (unsigned char)(low >> 32);
+            unsigned char pending = cache;
+            do {
+                output.push_back((unsigned char)(pending + carry));
+                pending = 0xFF;
+            } while (--cache_size != 0);
+            cache = (unsigned char)(low >> 24);
+        }
+        cache_size++;
+        low = (low & 0x00FFFFFFu) << 8;
+    }
+
+public:
+    explicit RangeEncoder(std::vector<unsigned char>& out) : output(out), low(0), range(0xFFFFFFFFu), cache(0), cache_size(1) {}
+
+    void encode_bit(uint16_t& probability, int bit) {
+        uint32_t bound = (range >> PROBABILITY_BITS) * probability;
+        if (bit == 0) {
+            range = bound;
+            probability += (PROBABILITY_ONE - probability) >> ADAPTATION_SHIFT;
+        } else {
+            low += bound;
+            range -= bound;
+            probability -= probability >> ADAPTATION_SHIFT;
+        }
+        while (range < TOP) {
+            range <<= 8;
+            shift_low();
+        }
+    }
+
+    void flush() {
+        for (int i = 0; i < 5; i++) {
+            shift_low();
+        }
+    }
+};
+
+// Matching decoder, reads zeros past the end of the buffer
+class RangeDecoder {
+private:
+    const unsigned char* data;
+    std::size_t size, position;
+    uint32_t range, code;
+
+    unsigned char next_byte() {
+        return position < size ? data[position++] : 0;
+    }
+
+public:
+    RangeDecoder(const unsigned char* d, std::size_t s) : data(d), size(s), position(0), range(0xFFFFFFFFu), code(0) {
+        for (int i = 0; i < 5; i++) {
+            code = (code << 8) | next_byte();
+        }
+    }
+
+    int decode_bit(uint16_t& probability) {
+        uint32_t bound = (range >> PROBABILITY_BITS) * probability;
+        int bit;
+        if (code < bound) {
+            range = bound;
+            probability += (PROBABILITY_ONE - probability) >> ADAPTATION_SHIFT;
+            bit = 0;
+        } else {
+            code -= bound;
+            range -= bound;
+            probability -= probability >> ADAPTATION_SHIFT;
+            bit = 1;
+        }
+        while (range < TOP) {
+            range <<= 8;
+            code = (code << 8) | next_byte();
+        }
+        return bit;
+    }
+};
+
+// One binary tree of probabilities per context, a byte is coded as 8 decisions from the top bit down
+struct ResidualModel {
+    uint16_t trees[CONTEXTS][256];
+
+    ResidualModel() {
+        for (int c = 0; c < CONTEXTS; c++) {
+            for (int node = 0; node < 256; node++) {
+                trees[c][node] = PROBABILITY_ONE / 2;
+            }
+        }
+    }
+};
+
+} // namespace
+
+// Predict each value from the previous one and code the residual modulo 256
+std::vector<unsigned char> Compression::compress_chunk(const int* values, int count) {
+    std::vector<unsigned char> output;
+    RangeEncoder encoder(output);
+    ResidualModel model;
+    int previous = 0, context = 0;
+    for (int k = 0; k < count; k++) {
+        if (values[k] < 0 || values[k] > 255) {
+            throw std::invalid_argument("Only pixel values between 0 and 255 can be compressed.");
+        }
+        int residual = (values[k] - previous) & 0xFF;
+        int node = 1;
+        for (int bit_index = 7; bit_index >= 0; bit_index--) {
+            int bit = (residual >> bit_index) & 1;
+            encoder.encode_bit(model.trees[context][node], bit);
+            node = (node << 1) | bit;
+        }
+        previous = values[k];
+        context = context_of(residual);
+    }
+    encoder.flush();
+    return output;
+}
+
+// Decode the residuals and undo the prediction
+void Compression::decompress_chunk(const unsigned char* data, std::size_t size, int* values, int count) {
+    RangeDecoder decoder(data, size);
+    ResidualModel model;
+    int previous = 0, context = 0;
+    for (int k = 0; k < count; k++) {
+        int node = 1;
+        for (int bit_index = 0; bit_index < 8; bit_index++) {
+            node = (node << 1) | decoder.decode_bit(model.trees[context][node]);
+        }
+        int residual = node & 0xFF;
+        values[k] = (previous + residual) & 0xFF;
+        previous = values[k];
+        context = context_of(residual);
+    }
+}
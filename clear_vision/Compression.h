@@ -0,0 +1,19 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <cstddef>
+#include <vector>
+
+// Lossless coder for runs of 8-bit pixel values. Each value is predicted by the previous one
+// and the prediction residual is entropy coded with an adaptive binary range coder, so a
+// compressed chunk needs no tables and decodes independently of every other chunk.
+class Compression {
+public:
+    // Compresses count values, each of which must lie in [0, 255]
+    static std::vector<unsigned char> compress_chunk(const int* values, int count);
+
+    // Restores count values from a buffer written by compress_chunk
+    static void decompress_chunk(const unsigned char* data, std::size_t size, int* values, int count);
+};
+
+#endif // COMPRESSION_H
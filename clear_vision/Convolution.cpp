@@ -0,0 +1,748 @@
+#include "Convolution.h"
+#include "Tuning.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+typedef std::complex<double> Complex;
+
+// Budget set by a ThreadBudget on this thread, 0 when the default applies
+thread_local int current_thread_budget = 0;
+
+// Hardware threads, capped at 8 because the strategies stop scaling beyond that
+int default_thread_budget() {
+    return (int)std::max(1u, std::min(std::thread::hardware_concurrency(), 8u));
+}
+
+// Smallest power of two that is >= n
+int next_power_of_two(int n) {
+    int power = 1;
+    while (power < n) power <<= 1;
+    return power;
+}
+
+// Runs body(begin, end) over [0, count) split into contiguous chunks on up to `threads` threads
+void parallel_for(int count, int threads, const std::function<void(int, int)>& body) {
+    threads = std::max(1, std::min(threads, count));
+    if (threads == 1) {
+        body(0, count);
+        return;
+    }
+    // Helper threads count towards the profiling scope of the caller
+    Profiler::Scope* scope = Profiler::current_scope();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        int begin = (int)((long long)count * t / threads), end = (int)((long long)count * (t + 1) / threads);
+        workers.push_back(std::thread([&body, scope, begin, end]() {
+            Profiler::Attach attach(scope);
+            body(begin, end);
+        }));
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+// In-place iterative radix-2 FFT over n (a power of two) values spaced by stride.
+// twiddles holds exp(-2 pi i k / n) for k < n / 2.
+void fft(Complex* data, int n, int stride, const std::vector<Complex>& twiddles, bool inverse) {
+    // 1. Bit-reversal permutation.
+    for (int i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(data[i * stride], data[j * stride]);
+    }
+    // 2. Butterflies, reading the twiddle table with a stride for the shorter transforms.
+    for (int length = 2; length <= n; length <<= 1) {
+        int half = length / 2, step = n / length;
+        for (int start = 0; start < n; start += length) {
+            for (int k = 0; k < half; k++) {
+                Complex w = inverse ? std::conj(twiddles[k * step]) : twiddles[k * step];
+                Complex& a = data[(start + k) * stride];
+                Complex& b = data[(start + k + half) * stride];
+                Complex t = b * w;
+                b = a - t;
+                a += t;
+            }
+        }
+    }
+}
+
+// 2D FFT of an n x n row-major block: rows first, then columns
+void fft_2d(std::vector<Complex>& block, int n, const std::vector<Complex>& twiddles, bool inverse) {
+    for (int i = 0; i < n; i++) fft(&block[i * n], n, 1, twiddles, inverse);
+    for (int j = 0; j < n; j++) fft(&block[j], n, n, twiddles, inverse);
+}
+
+// Direct correlation of one pixel, summing the taps in row-major order like the original filters
+double direct_pixel(int** pixels, int width, int height, const Kernel& kernel, int i, int j) {
+    int center_row = kernel.rows / 2, center_col = kernel.cols / 2;
+    int first_row = std::max(0, center_row - i), last_row = std::min(kernel.rows, height - i + center_row);
+    int first_col = std::max(0, center_col - j), last_col = std::min(kernel.cols, width - j + center_col);
+    double total = 0;
+    for (int a = first_row; a < last_row; a++) {
+        const int* row = pixels[i - center_row + a] + (j - center_col);
+        const double* weights = &kernel.weights[a * kernel.cols];
+        for (int b = first_col; b < last_col; b++) {
+            total += row[b] * weights[b];
+        }
+    }
+    return total;
+}
+
+// Output rectangle in image coordinates; sums are stored row-major for this rectangle only
+struct Region {
+    int x, y, width, height;
+};
+
+// Direct correlation of the region
+void direct_sums(const GrayscaleImage& image, const Region& region, const Kernel& kernel, std::vector<double>& sums, int threads) {
+    int height = image.get_height(), width = image.get_width();
+    parallel_for(region.height, threads, [&](int begin, int end) {
+        for (int r = begin; r < end; r++) {
+            for (int c = 0; c < region.width; c++) {
+                sums[r * region.width + c] = direct_pixel(image.get_data(), width, height, kernel, region.y + r, region.x + c);
+            }
+        }
+    });
+}
+
+// Separable correlation: a horizontal pass with the row factor over the region and its halo rows,
+// then a vertical pass with the column factor
+void separable_sums(const GrayscaleImage& image, const Region& region, const std::vector<double>& column,
+                    const std::vector<double>& row, std::vector<double>& sums, int threads) {
+    int height = image.get_height(), width = image.get_width();
+    int rows = column.size(), cols = row.size();
+    int center_row = rows / 2, center_col = cols / 2;
+    int** pixels = image.get_data();
+    int first_input = std::max(0, region.y - center_row);
+    int last_input = std::min(height, region.y + region.height - center_row + rows - 1);
+
+    std::vector<double> horizontal((size_t)std::max(0, last_input - first_input) * region.width);
+    parallel_for(last_input - first_input, threads, [&](int begin, int end) {
+        for (int r = begin; r < end; r++) {
+            for (int c = 0; c < region.width; c++) {
+                int j = region.x + c;
+                int first = std::max(0, center_col - j), last = std::min(cols, width - j + center_col);
+                const int* source = pixels[first_input + r] + (j - center_col);
+                double total = 0;
+                for (int b = first; b < last; b++) {
+                    total += source[b] * row[b];
+                }
+                horizontal[r * region.width + c] = total;
+            }
+        }
+    });
+
+    // Whole rows are accumulated at once so the inner loop runs over contiguous memory
+    parallel_for(region.height, threads, [&](int begin, int end) {
+        for (int r = begin; r < end; r++) {
+            int i = region.y + r;
+            int first = std::max(0, center_row - i), last = std::min(rows, height - i + center_row);
+            double* target = &sums[r * region.width];
+            std::fill(target, target + region.width, 0.0);
+            for (int a = first; a < last; a++) {
+                const double* source = &horizontal[(i - center_row + a - first_input) * region.width];
+                double weight = column[a];
+                for (int c = 0; c < region.width; c++) {
+                    target[c] += weight * source[c];
+                }
+            }
+        }
+    });
+}
+
+// Box correlation with running sums, a constant number of additions per pixel for any kernel size.
+// Pixel sums of integers are exact in double, the common weight is applied at the end.
+void box_sums(const GrayscaleImage& image, const Region& region, int rows, int cols, double weight,
+              std::vector<double>& sums, int threads) {
+    int height = image.get_height(), width = image.get_width();
+    int center_row = rows / 2, center_col = cols / 2;
+    int** pixels = image.get_data();
+    int first_input = std::max(0, region.y - center_row);
+    int last_input = std::min(height, region.y + region.height - center_row + rows - 1);
+
+    // 1. Horizontal window sums: slide right by adding the entering and removing the leaving pixel.
+    std::vector<double> horizontal((size_t)std::max(0, last_input - first_input) * region.width);
+    parallel_for(last_input - first_input, threads, [&](int begin, int end) {
+        for (int r = begin; r < end; r++) {
+            const int* source = pixels[first_input + r];
+            double total = 0;
+            for (int b = std::max(0, region.x - center_col); b < std::min(width, region.x - center_col + cols); b++) {
+                total += source[b];
+            }
+            for (int c = 0; c < region.width; c++) {
+                int j = region.x + c;
+                if (c > 0) {
+                    int entering = j - center_col + cols - 1, leaving = j - center_col - 1;
+                    if (entering < width) total += source[entering];
+                    if (leaving >= 0) total -= source[leaving];
+                }
+                horizontal[r * region.width + c] = total;
+            }
+        }
+    });
+
+    // 2. Vertical window sums over whole rows; each band of rows starts its own running sum.
+    parallel_for(region.height, threads, [&](int begin, int end) {
+        std::vector<double> running(region.width, 0.0);
+        int first_row = region.y + begin - center_row;
+        for (int i = std::max(0, first_row); i < std::min(height, first_row + rows); i++) {
+            const double* source = &horizontal[(i - first_input) * region.width];
+            for (int c = 0; c < region.width; c++) running[c] += source[c];
+        }
+        for (int r = begin; r < end; r++) {
+            if (r > begin) {
+                int entering = region.y + r - center_row + rows - 1, leaving = region.y + r - center_row - 1;
+                if (entering < height) {
+                    const double* source = &horizontal[(entering - first_input) * region.width];
+                    for (int c = 0; c < region.width; c++) running[c] += source[c];
+                }
+                if (leaving >= 0) {
+                    const double* source = &horizontal[(leaving - first_input) * region.width];
+                    for (int c = 0; c < region.width; c++) running[c] -= source[c];
+                }
+            }
+            for (int c = 0; c < region.width; c++) sums[r * region.width + c] = weight * running[c];
+        }
+    });
+}
+
+// FFT size used for a kernel: the power of two with the lowest cost per output pixel.
+// Returns 0 at an infinite cost when no block size up to 4096 is larger than the kernel.
+int fft_size_for(const Kernel& kernel, double* cost_per_pixel) {
+    int largest = std::max(kernel.rows, kernel.cols);
+    int best_size = 0;
+    double best_cost = std::numeric_limits<double>::infinity();
+    for (int size = next_power_of_two(largest + 1); size <= 4 * next_power_of_two(largest + 1) && size <= 4096; size <<= 1) {
+        double tile = (double)(size - kernel.rows + 1) * (size - kernel.cols + 1);
+        // Two real tiles share one complex transform, each pair needs a forward and an inverse 2D FFT
+        double cost = (2.0 * size * size * std::log2((double)size * size) * 1.5 + 2.0 * size * size) / (2.0 * tile);
+        if (best_size == 0 || cost < best_cost) {
+            best_size = size;
+            best_cost = cost;
+        }
+    }
+    if (cost_per_pixel) *cost_per_pixel = best_cost;
+    return best_size;
+}
+
+// Overlap-add FFT correlation: the pixels the region depends on are cut into tiles, each tile is
+// convolved with the flipped kernel in the frequency domain and its full result is added back.
+// Threads take bands of tile rows and accumulate into private buffers that are merged in order.
+void fft_sums(const GrayscaleImage& image, const Region& region, const Kernel& kernel, int size,
+              std::vector<double>& sums, int threads) {
+    int height = image.get_height(), width = image.get_width();
+    int tile_rows = size - kernel.rows + 1, tile_cols = size - kernel.cols + 1;
+    int center_row = kernel.rows / 2, center_col = kernel.cols / 2;
+    // Offset between a full convolution index and the centred output position
+    int offset_row = kernel.rows - 1 - center_row, offset_col = kernel.cols - 1 - center_col;
+    int** pixels = image.get_data();
+
+    // Input rectangle the region reads, including its halo
+    int input_top = std::max(0, region.y - center_row);
+    int input_bottom = std::min(height, region.y + region.height - center_row + kernel.rows - 1);
+    int input_left = std::max(0, region.x - center_col);
+    int input_right = std::min(width, region.x + region.width - center_col + kernel.cols - 1);
+
+    std::vector<Complex> twiddles(size / 2);
+    for (int k = 0; k < size / 2; k++) {
+        twiddles[k] = std::polar(1.0, -2.0 * M_PI * k / size);
+    }
+
+    // 1. Spectrum of the flipped kernel, correlation becomes a convolution.
+    std::vector<Complex> spectrum(size * size, Complex(0, 0));
+    for (int a = 0; a < kernel.rows; a++) {
+        for (int b = 0; b < kernel.cols; b++) {
+            spectrum[a * size + b] = kernel.at(kernel.rows - 1 - a, kernel.cols - 1 - b);
+        }
+    }
+    fft_2d(spectrum, size, twiddles, false);
+
+    int tile_row_count = std::max(0, (input_bottom - input_top + tile_rows - 1) / tile_rows);
+    int tile_col_count = std::max(0, (input_right - input_left + tile_cols - 1) / tile_cols);
+    threads = std::max(1, std::min(threads, tile_row_count));
+    std::vector<std::vector<double> > partial(threads);
+    std::vector<int> partial_first_row(threads, 0);
+
+    parallel_for(threads, threads, [&](int first_band, int last_band) {
+        for (int band = first_band; band < last_band; band++) {
+            int first_tile = tile_row_count * band / threads, last_tile = tile_row_count * (band + 1) / threads;
+            // Region rows this band of tiles can reach
+            int first_row = std::max(region.y, input_top + first_tile * tile_rows - offset_row);
+            int last_row = std::min(region.y + region.height, input_top + last_tile * tile_rows + size - offset_row);
+            std::vector<double>& accumulator = partial[band];
+            accumulator.assign((size_t)std::max(0, last_row - first_row) * region.width, 0.0);
+            partial_first_row[band] = first_row;
+
+            std::vector<std::pair<int, int> > tiles;
+            for (int t = first_tile; t < last_tile; t++) {
+                for (int c = 0; c < tile_col_count; c++) {
+                    tiles.push_back(std::make_pair(input_top + t * tile_rows, input_left + c * tile_cols));
+                }
+            }
+
+            std::vector<Complex> block(size * size);
+            double scale = 1.0 / ((double)size * size);
+            for (size_t t = 0; t < tiles.size(); t += 2) {
+                // 2. Pack two real tiles into the real and imaginary parts of one transform.
+                std::fill(block.begin(), block.end(), Complex(0, 0));
+                for (int part = 0; part < 2 && t + part < tiles.size(); part++) {
+                    int y = tiles[t + part].first, x = tiles[t + part].second;
+                    for (int i = 0; i < tile_rows && y + i < input_bottom; i++) {
+                        for (int j = 0; j < tile_cols && x + j < input_right; j++) {
+                            if (part == 0) block[i * size + j].real(pixels[y + i][x + j]);
+                            else block[i * size + j].imag(pixels[y + i][x + j]);
+                        }
+                    }
+                }
+
+                // 3. Multiply with the kernel spectrum; the kernel is real, so both tiles stay separated.
+                fft_2d(block, size, twiddles, false);
+                for (int k = 0; k < size * size; k++) {
+                    block[k] *= spectrum[k];
+                }
+                fft_2d(block, size, twiddles, true);
+
+                // 4. Add the part of each full tile result that falls inside the region.
+                for (int part = 0; part < 2 && t + part < tiles.size(); part++) {
+                    int y = tiles[t + part].first, x = tiles[t + part].second;
+                    for (int n = 0; n < size; n++) {
+                        int i = y + n - offset_row;
+                        if (i < first_row || i >= last_row) continue;
+                        double* target = &accumulator[(size_t)(i - first_row) * region.width];
+                        for (int m = 0; m < size; m++) {
+                            int j = x + m - offset_col;
+                            if (j < region.x || j >= region.x + region.width) continue;
+                            const Complex& value = block[n * size + m];
+                            target[j - region.x] += (part == 0 ? value.real() : value.imag()) * scale;
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    // 5. Merge the bands in order.
+    std::fill(sums.begin(), sums.end(), 0.0);
+    for (int band = 0; band < threads; band++) {
+        const std::vector<double>& accumulator = partial[band];
+        size_t offset = (size_t)(partial_first_row[band] - region.y) * region.width;
+        for (size_t k = 0; k < accumulator.size(); k++) {
+            sums[offset + k] += accumulator[k];
+        }
+    }
+}
+
+// Computes the exact kernel sums of the region following the plan. Integral kernels have exact
+// integer sums, rounding removes the floating point error of the separable and FFT paths so
+// every strategy gives identical pixels. Other kernels only differ from the direct sum by
+// rounding noise, which matters when the result sits right on an integer and is truncated;
+// those few pixels are recomputed directly.
+void region_sums(const GrayscaleImage& image, const Region& region, const Kernel& kernel,
+                 const Convolution::Plan& plan, std::vector<double>& sums) {
+    if (kernel.rows < 1 || kernel.cols < 1) {
+        throw std::invalid_argument("Kernel must have at least one row and column.");
+    }
+    int height = image.get_height(), width = image.get_width();
+    Convolution::Strategy strategy = plan.strategy;
+    int threads = std::max(1, plan.threads);
+
+    sums.assign((size_t)region.width * region.height, 0.0);
+    std::vector<double> column, row;
+    if (strategy == Convolution::SEPARABLE && Convolution::separate(kernel, column, row)) {
+        separable_sums(image, region, column, row, sums, threads);
+    } else if (strategy == Convolution::BOX && Convolution::supports(kernel, Convolution::BOX)) {
+        box_sums(image, region, kernel.rows, kernel.cols, kernel.weights[0], sums, threads);
+    } else if (strategy == Convolution::FFT) {
+        int size = plan.fft_size;
+        int largest = std::max(kernel.rows, kernel.cols);
+        if (size <= largest || (size & (size - 1)) != 0) {
+            size = fft_size_for(kernel, nullptr);
+        }
+        if (size > largest) {
+            fft_sums(image, region, kernel, size, sums, threads);
+        } else {
+            // No block fits the kernel, the direct sums are the only exact option left
+            strategy = Convolution::DIRECT;
+            direct_sums(image, region, kernel, sums, threads);
+        }
+    } else {
+        strategy = Convolution::DIRECT;
+        direct_sums(image, region, kernel, sums, threads);
+    }
+
+    if (kernel.is_integral()) {
+        for (double& total : sums) {
+            total = std::floor(total + 0.5);
+        }
+    } else if (strategy != Convolution::DIRECT) {
+        double magnitude = 0;
+        for (double weight : kernel.weights) magnitude += std::fabs(weight);
+        double tolerance = 1e-9 * 255.0 * magnitude / std::fabs(kernel.divisor);
+        parallel_for(region.height, threads, [&](int begin, int end) {
+            for (int r = begin; r < end; r++) {
+                for (int c = 0; c < region.width; c++) {
+                    double scaled = sums[r * region.width + c] / kernel.divisor;
+                    if (std::fabs(scaled - std::floor(scaled + 0.5)) < tolerance) {
+                        sums[r * region.width + c] = direct_pixel(image.get_data(), width, height, kernel, region.y + r, region.x + c);
+                    }
+                }
+            }
+        });
+    }
+}
+
+// Pixel value of a kernel sum: divided, truncated like the original filters and clamped
+inline int sum_to_pixel(double total, double divisor) {
+    return std::min(255, std::max(0, (int)(total / divisor)));
+}
+
+// Estimated work per output pixel, in multiply-adds, of a strategy for a kernel
+double strategy_cost(const Kernel& kernel, Convolution::Strategy strategy) {
+    switch (strategy) {
+        case Convolution::DIRECT: return (double)kernel.rows * kernel.cols;
+        case Convolution::SEPARABLE: return kernel.rows + kernel.cols + 1.0;
+        case Convolution::BOX: return 6.0;
+        case Convolution::FFT: {
+            double cost;
+            fft_size_for(kernel, &cost);
+            return cost;
+        }
+        default: return 0;
+    }
+}
+
+} // namespace
+
+// Whole number weights let every strategy round its sums back to exact integers
+bool Kernel::is_integral() const {
+    for (double weight : weights) {
+        if (weight != std::floor(weight)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Load a kernel from a text or binary kernel file
+Kernel Convolution::load_kernel(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (file.is_open() == false) {
+        throw std::runtime_error("Can't open the kernel file " + filename);
+    }
+
+    char magic[8] = {0};
+    file.read(magic, 8);
+    if (file.gcount() == 8 && std::memcmp(magic, "CVKERNEL", 8) == 0) {
+        // Binary kernel
+        int32_t rows = 0, cols = 0;
+        double divisor = 1.0;
+        file.read(reinterpret_cast<char*>(&rows), sizeof(rows));
+        file.read(reinterpret_cast<char*>(&cols), sizeof(cols));
+        file.read(reinterpret_cast<char*>(&divisor), sizeof(divisor));
+        if (!file || rows <= 0 || cols <= 0) {
+            throw std::runtime_error("Invalid binary kernel header in " + filename);
+        }
+        Kernel kernel(rows, cols);
+        kernel.divisor = divisor;
+        file.read(reinterpret_cast<char*>(kernel.weights.data()), sizeof(double) * kernel.weights.size());
+        if (!file) {
+            throw std::runtime_error("Binary kernel file is truncated: " + filename);
+        }
+        return kernel;
+    }
+
+    // Text kernel: header line, then the weights in any layout
+    file.clear();
+    file.seekg(0);
+    std::string line, values;
+    std::vector<double> header;
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream tokens(line);
+        if (header.empty()) {
+            double number;
+            while (tokens >> number) header.push_back(number);
+        } else {
+            values += line + " ";
+        }
+    }
+    if (header.size() < 2 || header.size() > 3 || header[0] < 1 || header[1] < 1) {
+        throw std::runtime_error("Kernel file must start with 'rows cols [divisor]': " + filename);
+    }
+    Kernel kernel((int)header[0], (int)header[1]);
+    if (header.size() == 3) {
+        kernel.divisor = header[2];
+    }
+    std::istringstream tokens(values);
+    size_t count = 0;
+    double weight;
+    while (tokens >> weight) {
+        if (count < kernel.weights.size()) kernel.weights[count] = weight;
+        count++;
+    }
+    if (count != kernel.weights.size() || !tokens.eof()) {
+        throw std::runtime_error("Kernel file must contain rows * cols numeric weights: " + filename);
+    }
+    if (kernel.divisor == 0) {
+        throw std::runtime_error("Kernel divisor must not be zero: " + filename);
+    }
+    return kernel;
+}
+
+// size x size kernel of ones, divided by the number of taps
+Kernel Convolution::box_kernel(int size) {
+    Kernel kernel(size, size);
+    std::fill(kernel.weights.begin(), kernel.weights.end(), 1.0);
+    kernel.divisor = size * size;
+    return kernel;
+}
+
+// Normalized Gaussian kernel, computed exactly like the original smoothing filter
+Kernel Convolution::gaussian_kernel(int size, double sigma) {
+    Kernel kernel(size, size);
+    int center = size / 2;
+    double sum = 0;
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            int x = center - j;
+            int y = center - i;
+            kernel.at(i, j) = ((1 / (2.0 * M_PI * sigma * sigma)) * exp(-(x * x + y * y) / (2.0 * sigma * sigma)));
+            sum += kernel.at(i, j);
+        }
+    }
+    for (double& weight : kernel.weights) {
+        weight /= sum;
+    }
+    return kernel;
+}
+
+// Rank-1 detection with the power method on K^T K (leading singular vector)
+bool Convolution::separate(const Kernel& kernel, std::vector<double>& column, std::vector<double>& row) {
+    int rows = kernel.rows, cols = kernel.cols;
+    double energy = 0, largest = 0;
+    int pivot_row = 0, pivot_col = 0;
+    for (int a = 0; a < rows; a++) {
+        for (int b = 0; b < cols; b++) {
+            double weight = kernel.at(a, b);
+            energy += weight * weight;
+            if (std::fabs(weight) > largest) {
+                largest = std::fabs(weight);
+                pivot_row = a;
+                pivot_col = b;
+            }
+        }
+    }
+    if (energy == 0) {
+        return false;
+    }
+
+    // 1. Leading right singular vector v and singular value sigma = |K v|.
+    // Start from the row holding the largest weight, it cannot be orthogonal to the leading vector
+    std::vector<double> v(cols), u(rows);
+    double start_norm = 0;
+    for (int b = 0; b < cols; b++) start_norm += kernel.at(pivot_row, b) * kernel.at(pivot_row, b);
+    for (int b = 0; b < cols; b++) v[b] = kernel.at(pivot_row, b) / std::sqrt(start_norm);
+    double sigma_squared = 0;
+    for (int iteration = 0; iteration < 200; iteration++) {
+        for (int a = 0; a < rows; a++) {
+            u[a] = 0;
+            for (int b = 0; b < cols; b++) u[a] += kernel.at(a, b) * v[b];
+        }
+        std::vector<double> next(cols, 0.0);
+        for (int a = 0; a < rows; a++) {
+            for (int b = 0; b < cols; b++) next[b] += kernel.at(a, b) * u[a];
+        }
+        double norm = 0;
+        for (double value : next) norm += value * value;
+        norm = std::sqrt(norm);
+        if (norm == 0) {
+            return false;
+        }
+        double change = 0;
+        for (int b = 0; b < cols; b++) {
+            next[b] /= norm;
+            change = std::max(change, std::fabs(next[b] - v[b]));
+        }
+        v = next;
+        sigma_squared = norm; // |K^T K v| = sigma^2 once v has converged
+        if (change < 1e-14) break;
+    }
+
+    // 2. Rank 1 when the leading singular value carries all of the energy.
+    if (sigma_squared < energy * (1.0 - 1e-10)) {
+        return false;
+    }
+
+    // 3. Take the factors from the pivot row and column, this keeps integer kernels integral.
+    column.assign(rows, 0.0);
+    row.assign(cols, 0.0);
+    for (int a = 0; a < rows; a++) column[a] = kernel.at(a, pivot_col);
+    for (int b = 0; b < cols; b++) row[b] = kernel.at(pivot_row, b) / kernel.at(pivot_row, pivot_col);
+    for (int a = 0; a < rows; a++) {
+        for (int b = 0; b < cols; b++) {
+            if (std::fabs(column[a] * row[b] - kernel.at(a, b)) > 1e-9 * largest) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Box kernels have one common weight, separable ones are rank 1
+Convolution::KernelKind Convolution::classify(const Kernel& kernel) {
+    if (supports(kernel, BOX)) return BOX_KERNEL;
+    if (supports(kernel, SEPARABLE)) return SEPARABLE_KERNEL;
+    return DENSE_KERNEL;
+}
+
+// Structural requirements of each strategy
+bool Convolution::supports(const Kernel& kernel, Strategy strategy) {
+    if (strategy == BOX) {
+        for (double weight : kernel.weights) {
+            if (weight != kernel.weights[0]) return false;
+        }
+        return true;
+    }
+    if (strategy == SEPARABLE) {
+        std::vector<double> column, row;
+        return separate(kernel, column, row);
+    }
+    if (strategy == FFT) {
+        return fft_size_for(kernel, nullptr) > 0;
+    }
+    return true;
+}
+
+// Budget set on this thread, or the default one
+int Convolution::thread_budget() {
+    return current_thread_budget > 0 ? current_thread_budget : default_thread_budget();
+}
+
+// Each worker gets an equal share of the default budget
+int Convolution::shared_thread_budget(int workers) {
+    return std::max(1, default_thread_budget() / std::max(1, workers));
+}
+
+Convolution::ThreadBudget::ThreadBudget(int threads) : previous(current_thread_budget) {
+    current_thread_budget = std::max(1, threads);
+}
+
+Convolution::ThreadBudget::~ThreadBudget() {
+    current_thread_budget = previous;
+}
+
+// Tuned plan if the profile covers the kernel, else the lowest estimated multiply-adds per pixel
+Convolution::Plan Convolution::choose_plan(const Kernel& kernel, int width, int height, int max_threads) {
+    KernelKind kind = classify(kernel);
+    max_threads = std::max(1, max_threads);
+    Plan plan;
+    // The profile holds a measured plan per thread budget, take the one that fits this caller
+    if (Tuning::lookup(kind, width * height, std::max(kernel.rows, kernel.cols), max_threads, plan) && supports(kernel, plan.strategy)) {
+        return plan;
+    }
+
+    plan.strategy = DIRECT;
+    double best_cost = strategy_cost(kernel, DIRECT);
+    Strategy candidates[] = {SEPARABLE, BOX, FFT};
+    for (Strategy candidate : candidates) {
+        if ((candidate == BOX && kind != BOX_KERNEL) || (candidate == SEPARABLE && kind == DENSE_KERNEL)) continue;
+        // Tiles are only worth it once the image holds more than a couple of them
+        if (candidate == FFT && (double)width * height <= 2.0 * kernel.rows * kernel.cols) continue;
+        double cost = strategy_cost(kernel, candidate);
+        if (cost < best_cost) {
+            best_cost = cost;
+            plan.strategy = candidate;
+        }
+    }
+
+    // Spread large jobs over the thread budget, small ones are not worth the thread start up
+    if (best_cost * width * height > 4e6) {
+        plan.threads = max_threads;
+    }
+    return plan;
+}
+
+// Strategy of the chosen plan
+Convolution::Strategy Convolution::choose_strategy(const Kernel& kernel, int width, int height) {
+    return choose_plan(kernel, width, height).strategy;
+}
+
+// Convolve with the given strategy and the default execution settings
+void Convolution::apply(GrayscaleImage& image, const Kernel& kernel, Strategy strategy) {
+    apply(GrayscaleImageView(image), kernel, Plan(strategy));
+}
+
+// Convolve the whole image following the plan
+void Convolution::apply(GrayscaleImage& image, const Kernel& kernel, const Plan& plan) {
+    apply(GrayscaleImageView(image), kernel, plan);
+}
+
+// Convolve only the region, reading its halo from the surrounding image
+void Convolution::apply(GrayscaleImageView view, const Kernel& kernel, const Plan& requested) {
+    Profiler::Scope scope("conv", (long long)view.get_width() * view.get_height());
+    GrayscaleImage& image = view.get_image();
+    Plan plan = (requested.strategy == AUTO) ? choose_plan(kernel, view.get_width(), view.get_height()) : requested;
+    Region region = {view.get_x(), view.get_y(), view.get_width(), view.get_height()};
+    std::vector<double> sums;
+    region_sums(image, region, kernel, plan, sums);
+
+    // Every sum is computed before the first pixel is written back
+    for (int r = 0; r < region.height; r++) {
+        int* target = view.row_data(r);
+        for (int c = 0; c < region.width; c++) {
+            target[c] = sum_to_pixel(sums[r * region.width + c], kernel.divisor);
+        }
+    }
+}
+
+// Convolve the region into a new image of the region's size
+GrayscaleImage Convolution::convolve(const GrayscaleImageView& view, const Kernel& kernel, const Plan& requested) {
+    Profiler::Scope scope("conv", (long long)view.get_width() * view.get_height());
+    Plan plan = (requested.strategy == AUTO) ? choose_plan(kernel, view.get_width(), view.get_height()) : requested;
+    Region region = {view.get_x(), view.get_y(), view.get_width(), view.get_height()};
+    std::vector<double> sums;
+    region_sums(view.get_image(), region, kernel, plan, sums);
+
+    GrayscaleImage result(region.width, region.height);
+    for (int r = 0; r < region.height; r++) {
+        int* target = result.get_data()[r];
+        for (int c = 0; c < region.width; c++) {
+            target[c] = sum_to_pixel(sums[r * region.width + c], kernel.divisor);
+        }
+    }
+    return result;
+}
+
+// Strategy names for reports
+const char* Convolution::strategy_name(Strategy strategy) {
+    switch (strategy) {
+        case DIRECT: return "direct";
+        case SEPARABLE: return "separable";
+        case FFT: return "fft";
+        case BOX: return "box";
+        default: return "auto";
+    }
+}
+
+// Strategy for a name printed by strategy_name
+Convolution::Strategy Convolution::strategy_from_name(const std::string& name) {
+    if (name == "direct") return DIRECT;
+    if (name == "separable") return SEPARABLE;
+    if (name == "fft") return FFT;
+    if (name == "box") return BOX;
+    return AUTO;
+}
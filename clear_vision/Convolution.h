@@ -0,0 +1,107 @@
+#ifndef CONVOLUTION_H
+#define CONVOLUTION_H
+
+#include "GrayscaleImage.h"
+#include "GrayscaleImageView.h"
+#include <string>
+#include <vector>
+
+// Dense 2D kernel. Like the built-in filters it is centred on (rows / 2, cols / 2),
+// pixels outside the image count as zero and the result is sum / divisor.
+struct Kernel {
+    int rows, cols;
+    std::vector<double> weights; // row-major, rows * cols values
+    double divisor;
+
+    Kernel(int r = 0, int c = 0) : rows(r), cols(c), weights(r * c, 0.0), divisor(1.0) {}
+
+    double& at(int row, int col) { return weights[row * cols + col]; }
+    double at(int row, int col) const { return weights[row * cols + col]; }
+
+    // True when every weight is a whole number, sums are then exact and rounded before dividing
+    bool is_integral() const;
+};
+
+// General convolution engine that picks the cheapest exact strategy for a kernel
+class Convolution {
+public:
+    enum Strategy { AUTO, DIRECT, SEPARABLE, FFT, BOX };
+
+    // Structural class of a kernel, used to look up tuned plans
+    enum KernelKind { BOX_KERNEL, SEPARABLE_KERNEL, DENSE_KERNEL };
+
+    // How a convolution is executed: the strategy, the FFT block size (0 picks it
+    // from the cost model) and the number of threads sharing the work.
+    struct Plan {
+        Strategy strategy;
+        int fft_size;
+        int threads;
+
+        Plan(Strategy s = AUTO, int size = 0, int t = 1) : strategy(s), fft_size(size), threads(t) {}
+    };
+
+    // Reads a kernel from a text file ("rows cols [divisor]" then the weights, '#' starts a comment)
+    // or from a binary file ("CVKERNEL", int32 rows, int32 cols, double divisor, doubles row-major).
+    static Kernel load_kernel(const std::string& filename);
+
+    // Kernels of the built-in filters
+    static Kernel box_kernel(int size);
+    static Kernel gaussian_kernel(int size, double sigma);
+
+    // Detects rank-1 kernels (largest singular value carries all the energy) and splits them
+    // into a column and a row factor with kernel(r, c) == column[r] * row[c].
+    static bool separate(const Kernel& kernel, std::vector<double>& column, std::vector<double>& row);
+
+    // Box (all weights equal), separable or dense
+    static KernelKind classify(const Kernel& kernel);
+
+    // Whether a strategy can run the kernel (BOX needs equal weights, SEPARABLE a rank-1 kernel,
+    // FFT a kernel smaller than the largest block of 4096)
+    static bool supports(const Kernel& kernel, Strategy strategy);
+
+    // Thread budget of the calling thread: the most threads choose_plan gives one convolution.
+    // It defaults to the hardware threads (at most 8). Code that already runs convolutions on
+    // several threads at once must split the default between them, otherwise every worker
+    // starts its own full set of threads. The batch and sweep workers each hold a
+    // ThreadBudget of shared_thread_budget(workers) while they run.
+    static int thread_budget();
+
+    // The default budget divided between `workers` concurrent callers, at least 1 each
+    static int shared_thread_budget(int workers);
+
+    // Sets the calling thread's budget for its lifetime and restores the previous one afterwards
+    class ThreadBudget {
+    public:
+        explicit ThreadBudget(int threads);
+        ~ThreadBudget();
+
+    private:
+        int previous;
+    };
+
+    // Plan for an image of the given size: the tuning profile when it covers the case,
+    // otherwise the cheapest strategy by estimated cost per pixel. Never uses more than
+    // max_threads threads; explicit plans passed to apply run as given.
+    static Plan choose_plan(const Kernel& kernel, int width, int height, int max_threads = thread_budget());
+
+    // Strategy part of choose_plan
+    static Strategy choose_strategy(const Kernel& kernel, int width, int height);
+
+    // Convolves the image with the kernel in place, clamping the result to [0, 255].
+    // Every strategy, block size and thread count gives the same pixels.
+    static void apply(GrayscaleImage& image, const Kernel& kernel, Strategy strategy = AUTO);
+    static void apply(GrayscaleImage& image, const Kernel& kernel, const Plan& plan);
+
+    // Convolves only the region of the view in place; pixels around it are read as the halo,
+    // so the result inside the region equals the whole-image result there.
+    static void apply(GrayscaleImageView view, const Kernel& kernel, const Plan& plan = Plan());
+
+    // Same as apply on a view, but returns the region's result as a new image
+    static GrayscaleImage convolve(const GrayscaleImageView& view, const Kernel& kernel, const Plan& plan = Plan());
+
+    // Human readable strategy name and its inverse (AUTO for unknown names)
+    static const char* strategy_name(Strategy strategy);
+    static Strategy strategy_from_name(const std::string& name);
+};
+
+#endif // CONVOLUTION_H
@@ -1,9 +1,11 @@
 #include "Crypto.h"
+#include "Profiler.h"
 #include "GrayscaleImage.h"
 
 
 // Extract the least significant bits (LSBs) from SecretImage, calculating x, y based on message length
 std::vector<int> Crypto::extract_LSBits(SecretImage& secret_image, int message_length) {
+    Profiler::Scope scope("extract_lsb", (long long)secret_image.get_width() * secret_image.get_height());
     std::vector<int> LSB_array;
 
     // 1. Reconstruct the SecretImage to a GrayscaleImage.
@@ -87,6 +89,7 @@ std::vector<int> Crypto::encrypt_message(const std::string& message) {
 
 // Embed LSB array into GrayscaleImage starting from the last bit of the image
 SecretImage Crypto::embed_LSBits(GrayscaleImage& image, const std::vector<int>& LSB_array) {
+    Profiler::Scope scope("embed_lsb", (long long)image.get_width() * image.get_height());
     
     GrayscaleImage copy_image = image;
     // 1. Ensure the image has enough pixels to store the LSB array, else throw an error.
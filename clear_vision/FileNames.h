@@ -0,0 +1,20 @@
+#ifndef FILE_NAMES_H
+#define FILE_NAMES_H
+
+#include <string>
+
+// Output naming shared by the single image operations, batch and sweep modes
+
+// Removes the file extension from a filename, keeping any directory
+inline std::string remove_extension(const std::string& filename) {
+    size_t last_dot = filename.find_last_of(".");
+    return (last_dot != std::string::npos && last_dot > 0) ? filename.substr(0, last_dot) : filename;
+}
+
+// File name without its directory and extension: "dir/puppy.png" becomes "puppy"
+inline std::string output_stem(const std::string& path) {
+    size_t last_slash = path.find_last_of('/');
+    return remove_extension((last_slash == std::string::npos) ? path : path.substr(last_slash + 1));
+}
+
+#endif // FILE_NAMES_H
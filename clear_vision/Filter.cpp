@@ -1,96 +1,198 @@
 #include "Filter.h"
+#include "Convolution.h"
+#include "Profiler.h"
 #include <algorithm>
 #include <cmath>
 #include <vector>
 #include <numeric>
 #include <math.h>
 #include <iostream>
+#include <stdexcept>
+#include <functional>
+#include <limits>
 
-// Mean Filter
-void Filter::apply_mean_filter(GrayscaleImage& image, int kernelSize) {
-    // 1. Copy the original image for reference.
-    GrayscaleImage copy_image = image; // copy constructor
-    // 2. For each pixel, calculate the mean value of its neighbors using a kernel.
-    int pixel_value = 0, kernel_index_row = 0, kernel_index_column = 0;
-    for(int i = 0; i < copy_image.get_height(); i++) {
-        for (int j = 0; j < copy_image.get_width(); j++) {
-            
-            int kernel_total = 0;
-            for(int i_kernel = 0; i_kernel < kernelSize; i_kernel++) {
-                for (int j_kernel = 0; j_kernel < kernelSize; j_kernel++) {
-                    kernel_index_row = i - (kernelSize/2) + i_kernel;
-                    kernel_index_column = j - (kernelSize/2) + j_kernel;
-                    
-                    if (kernel_index_row < 0 || kernel_index_column < 0 || kernel_index_row >= copy_image.get_height() || kernel_index_column>= copy_image.get_width()) {
-                        pixel_value = 0;
-                    } else {
-                        pixel_value = copy_image.get_pixel(kernel_index_row, kernel_index_column);
-                    }
-                    
-                    kernel_total += pixel_value;
-                }
-                
+namespace {
+
+// Variance, in full resolution pixels, added by reducing to a pyramid level and expanding back:
+// every [1 4 6 4 1] reduction adds 4^l and every bilinear expansion 4^l / 2.
+double pyramid_variance(int level) {
+    return (std::pow(4.0, level) - 1.0) / 2.0;
+}
+
+// Filters the coarsest level of the pyramid and expands the result back to full resolution.
+// The exact filters read zeros outside the image while the pyramid clamps at its border, so the
+// image is first placed in a zero margin wider than the kernel radius plus the pyramid's own spread.
+// The margin is a whole number of coarse pixels, which keeps every level aligned with the image.
+void filter_at_level(GrayscaleImage& image, int level, int radius, const std::function<void(GrayscaleImage&)>& filter) {
+    int step = 1 << level;
+    int margin = (radius + 3 * step + step - 1) / step * step;
+    int width = image.get_width(), height = image.get_height();
+    GrayscaleImage padded(width + 2 * margin, height + 2 * margin);
+    for (int i = 0; i < padded.get_height(); i++) {
+        int* row = padded.get_data()[i];
+        if (i < margin || i >= margin + height) {
+            std::fill(row, row + padded.get_width(), 0);
+        } else {
+            std::fill(row, row + margin, 0);
+            std::copy(image.get_data()[i - margin], image.get_data()[i - margin] + width, row + margin);
+            std::fill(row + margin + width, row + padded.get_width(), 0);
+        }
+    }
+
+    std::vector<GrayscaleImage> pyramid = padded.build_pyramid(level);
+    filter(pyramid[level]);
+    for (int l = level; l > 0; l--) {
+        pyramid[l - 1] = pyramid[l].upsample(pyramid[l - 1].get_width(), pyramid[l - 1].get_height());
+    }
+    for (int i = 0; i < height; i++) {
+        std::copy(pyramid[0].get_data()[i + margin] + margin, pyramid[0].get_data()[i + margin] + margin + width, image.get_data()[i]);
+    }
+}
+
+// Blurs a 3D grid stored x fastest, then y, then z, along one axis with the given taps centred on taps.size() / 2.
+// Cells beyond the grid count as zero, the grid is padded so nothing is lost there.
+void blur_grid_axis(std::vector<double>& grid, const int dims[3], int axis, const std::vector<double>& taps) {
+    // Cell counts and offsets are size_t, large images with fine sigmas exceed the int range
+    size_t plane = (size_t)dims[0] * dims[1];
+    size_t stride = (axis == 0) ? 1 : (axis == 1) ? (size_t)dims[0] : plane;
+    int length = dims[axis];
+    int center = taps.size() / 2;
+    std::vector<double> line(length);
+    size_t lines = plane * dims[2] / length;
+    for (size_t l = 0; l < lines; l++) {
+        // Start of the l-th line along the axis
+        size_t start;
+        if (axis == 0) start = l * dims[0];
+        else if (axis == 1) start = (l / dims[0]) * plane + l % dims[0];
+        else start = l;
+        for (int k = 0; k < length; k++) line[k] = grid[start + k * stride];
+        for (int k = 0; k < length; k++) {
+            double total = 0;
+            for (int t = std::max(0, center - k); t < (int)taps.size() && k - center + t < length; t++) {
+                total += taps[t] * line[k - center + t];
             }
-            // 3. Update each pixel with the computed mean.
-            int avrage = kernel_total / (kernelSize*kernelSize);
-            image.set_pixel(i,j, avrage);
+            grid[start + k * stride] = total;
         }
-        
     }
-    
 }
 
-// Gaussian Smoothing Filter
-void Filter::apply_gaussian_smoothing(GrayscaleImage& image, int kernelSize, double sigma) {
-    // 1. Create a Gaussian kernel based on the given sigma value.
-    int center= kernelSize/2;
-    double sum=0;
+// Running minimum or maximum of the morphology filters
+struct MinimumOperation {
+    static int identity() { return std::numeric_limits<int>::max(); }
+    static int apply(int a, int b) { return a < b ? a : b; }
+};
+
+struct MaximumOperation {
+    static int identity() { return std::numeric_limits<int>::min(); }
+    static int apply(int a, int b) { return a > b ? a : b; }
+};
 
-    std::vector<std::vector<double>> kernel(kernelSize, std::vector<double>(kernelSize));
-    for (int i=0; i<kernelSize; i++) {
-        for (int j = 0; j<kernelSize; j++) {
-            int x = center- j;
-            int y = center - i;
-            kernel[i][j] = ( (1 / (2.0 * M_PI * sigma*sigma)) * exp(-(x*x + y*y) / (2.0*sigma*sigma)));
-            sum += kernel[i][j];
+// van Herk/Gil-Werman: out[t] = Op over line[t .. t + size). The line is cut into blocks of size values;
+// prefix results inside each block (forward) and suffix results (backward) give every window from one
+// suffix and one prefix, about three comparisons per value for any size.
+// Each "value" is a row of count ints, whole rows are combined at once in loops the compiler can vectorize.
+template <typename Op>
+void van_herk_gil_werman(const std::vector<const int*>& line, int size, int count, int outputs,
+                         std::vector<int>& forward, std::vector<int>& backward, const std::function<int*(int)>& output) {
+    int length = line.size();
+    forward.resize((size_t)length * count);
+    backward.resize((size_t)length * count);
+    for (int block = 0; block < length; block += size) {
+        int end = std::min(length, block + size);
+        // 1. Prefix within the block.
+        std::copy(line[block], line[block] + count, &forward[(size_t)block * count]);
+        for (int t = block + 1; t < end; t++) {
+            const int* previous = &forward[(size_t)(t - 1) * count];
+            const int* source = line[t];
+            int* target = &forward[(size_t)t * count];
+            for (int c = 0; c < count; c++) target[c] = Op::apply(previous[c], source[c]);
         }
-    }
-    // 2. Normalize the kernel to ensure it sums to 1.
-    for (int i = 0; i < kernelSize; i++) {
-        for (int j = 0; j < kernelSize; j++) {
-            kernel[i][j] /= sum;
+        // 2. Suffix within the block.
+        std::copy(line[end - 1], line[end - 1] + count, &backward[(size_t)(end - 1) * count]);
+        for (int t = end - 2; t >= block; t--) {
+            const int* next = &backward[(size_t)(t + 1) * count];
+            const int* source = line[t];
+            int* target = &backward[(size_t)t * count];
+            for (int c = 0; c < count; c++) target[c] = Op::apply(next[c], source[c]);
         }
     }
-    // 3. For each pixel, compute the weighted sum using the kernel.
-    GrayscaleImage copy_image = image;
-    int pixel_value = 0, kernel_index_row = 0, kernel_index_column = 0;
-    for(int i = 0; i < copy_image.get_height(); i++) {
-        for (int j = 0; j < copy_image.get_width(); j++) {
-            
-            double kernel_total = 0;
-            for(int i_kernel = 0; i_kernel < kernelSize; i_kernel++) {
-                for (int j_kernel = 0; j_kernel < kernelSize; j_kernel++) {
-                    kernel_index_row = i - (kernelSize/2) + i_kernel;
-                    kernel_index_column = j - (kernelSize/2) + j_kernel;
-                    
-                    if (kernel_index_row < 0 || kernel_index_column < 0 || kernel_index_row >= copy_image.get_height() || kernel_index_column>= copy_image.get_width()) {
-                        pixel_value = 0;
-                    } else {
-                        pixel_value = copy_image.get_pixel(kernel_index_row, kernel_index_column);
-                    }
-                    kernel_total += pixel_value * kernel[i_kernel][j_kernel];
-                }
-                
-            }
-            // 4. Update the pixel values with the smoothed results.
-            image.set_pixel(i, j, (int)(kernel_total));
+    // 3. Window [t, t + size) = suffix from t combined with the prefix up to t + size - 1.
+    for (int t = 0; t < outputs; t++) {
+        const int* suffix = &backward[(size_t)t * count];
+        const int* prefix = &forward[(size_t)(t + size - 1) * count];
+        int* target = output(t);
+        for (int c = 0; c < count; c++) target[c] = Op::apply(suffix[c], prefix[c]);
+    }
+}
+
+// Vertical pass: rows[i] becomes Op over rows [i - offset, i - offset + size), rows outside count as the identity
+template <typename Op>
+void morphology_pass(const std::vector<int*>& rows, int count, int size, int offset) {
+    int row_count = rows.size();
+    std::vector<int> identity_row(count, Op::identity());
+    // Padded line: the identity before and after the rows, rounded up to whole blocks
+    std::vector<const int*> line((row_count + size - 1 + size - 1) / size * size);
+    for (int t = 0; t < (int)line.size(); t++) {
+        int i = t - offset;
+        line[t] = (i >= 0 && i < row_count) ? rows[i] : identity_row.data();
+    }
+    std::vector<int> forward, backward, result((size_t)row_count * count);
+    van_herk_gil_werman<Op>(line, size, count, row_count, forward, backward,
+                            [&](int i) { return &result[(size_t)i * count]; });
+    for (int i = 0; i < row_count; i++) {
+        std::copy(&result[(size_t)i * count], &result[(size_t)i * count] + count, rows[i]);
+    }
+}
+
+// Separable rectangular erosion (Op = minimum) or dilation (maximum) over windows covering
+// columns [j - offset_x, j - offset_x + width) and rows [i - offset_y, i - offset_y + height).
+// Pixels outside the image do not take part, like the windows of the rank filters.
+// Both passes run along contiguous memory: the horizontal one works on the transposed image.
+template <typename Op>
+void rectangle_morphology(GrayscaleImage& image, int width, int height, int offset_x, int offset_y) {
+    int image_height = image.get_height(), image_width = image.get_width();
+    int** pixels = image.get_data();
+
+    // 1. Vertical pass on the image rows.
+    std::vector<int*> rows(pixels, pixels + image_height);
+    morphology_pass<Op>(rows, image_width, height, offset_y);
+
+    // 2. Horizontal pass as a vertical pass on the transposed image.
+    if (width > 1) {
+        std::vector<int> transposed((size_t)image_width * image_height);
+        std::vector<int*> columns(image_width);
+        for (int j = 0; j < image_width; j++) columns[j] = &transposed[(size_t)j * image_height];
+        for (int i = 0; i < image_height; i++) {
+            for (int j = 0; j < image_width; j++) columns[j][i] = pixels[i][j];
         }
-        
-    }    
+        morphology_pass<Op>(columns, image_height, width, offset_x);
+        for (int i = 0; i < image_height; i++) {
+            for (int j = 0; j < image_width; j++) pixels[i][j] = columns[j][i];
+        }
+    }
+}
+
+} // namespace
+
+// Mean Filter
+void Filter::apply_mean_filter(GrayscaleImage& image, int kernelSize) {
+    Profiler::Scope scope("mean", (long long)image.get_width() * image.get_height());
+    // The box kernel is integral, so every convolution strategy reproduces the
+    // integer sum divided by kernelSize * kernelSize exactly.
+    Convolution::apply(image, Convolution::box_kernel(kernelSize));
+}
+
+// Gaussian Smoothing Filter
+void Filter::apply_gaussian_smoothing(GrayscaleImage& image, int kernelSize, double sigma) {
+    Profiler::Scope scope("gauss", (long long)image.get_width() * image.get_height());
+    // 1. Create a normalized Gaussian kernel based on the given sigma value.
+    // 2. Let the convolution engine pick the cheapest strategy for it (separable for a Gaussian).
+    Convolution::apply(image, Convolution::gaussian_kernel(kernelSize, sigma));
 }
 
 // Unsharp Masking Filter
 void Filter::apply_unsharp_mask(GrayscaleImage& image, int kernelSize, double amount) {
+    Profiler::Scope scope("unsharp", (long long)image.get_width() * image.get_height());
     GrayscaleImage original_image = image;
     GrayscaleImage blurred_image = image;
 
@@ -131,3 +233,354 @@ void Filter::apply_unsharp_mask(GrayscaleImage& image, int kernelSize, double am
     }
     
 }
+
+// Mean Filter of a region
+void Filter::apply_mean_filter(GrayscaleImageView view, int kernelSize) {
+    Profiler::Scope scope("mean", (long long)view.get_width() * view.get_height());
+    Convolution::apply(view, Convolution::box_kernel(kernelSize));
+}
+
+// Gaussian Smoothing Filter of a region
+void Filter::apply_gaussian_smoothing(GrayscaleImageView view, int kernelSize, double sigma) {
+    Profiler::Scope scope("gauss", (long long)view.get_width() * view.get_height());
+    Convolution::apply(view, Convolution::gaussian_kernel(kernelSize, sigma));
+}
+
+// Unsharp Masking Filter of a region, the blur reads the halo around the region
+void Filter::apply_unsharp_mask(GrayscaleImageView view, int kernelSize, double amount) {
+    Profiler::Scope scope("unsharp", (long long)view.get_width() * view.get_height());
+    GrayscaleImage blurred_image = Convolution::convolve(view, Convolution::gaussian_kernel(kernelSize, 1));
+    view.assign(sharpen(view.to_image(), blurred_image, amount));
+}
+
+// Unsharp mask formula on a precomputed blur: original + amount * (original - blurred), clipped to [0-255]
+GrayscaleImage Filter::sharpen(const GrayscaleImage& original_image, const GrayscaleImage& blurred_image, double amount) {
+    if (original_image.get_width() != blurred_image.get_width() || original_image.get_height() != blurred_image.get_height()) {
+        throw std::invalid_argument("Blurred image must have the size of the original.");
+    }
+    Profiler::Scope scope("sharpen", (long long)original_image.get_width() * original_image.get_height());
+    GrayscaleImage result(original_image.get_width(), original_image.get_height());
+    for (int i = 0; i < original_image.get_height(); i++) {
+        const int* original_row = original_image.get_data()[i];
+        const int* blurred_row = blurred_image.get_data()[i];
+        int* target = result.get_data()[i];
+        for (int j = 0; j < original_image.get_width(); j++) {
+            int unsharp_pixel = original_row[j] + amount * (original_row[j] - blurred_row[j]);
+            if (unsharp_pixel < 0) unsharp_pixel = 0;
+            if (unsharp_pixel > 255) unsharp_pixel = 255;
+            target[j] = unsharp_pixel;
+        }
+    }
+    return result;
+}
+
+// Multi-scale Gaussian Smoothing Filter
+int Filter::apply_gaussian_smoothing_multiscale(GrayscaleImage& image, int kernelSize, double sigma, int levels) {
+    Profiler::Scope scope("gauss_pyr", (long long)image.get_width() * image.get_height());
+    // 1. Pick the pyramid level: the pyramid itself must blur less than the requested sigma,
+    //    and in automatic mode the remaining sigma has to cover at least ~one coarse pixel.
+    int smallest_side = std::min(image.get_width(), image.get_height());
+    int level = 0;
+    while ((smallest_side >> (level + 1)) > 0 && pyramid_variance(level + 1) < sigma * sigma) {
+        double coarse_sigma = std::sqrt(sigma * sigma - pyramid_variance(level + 1)) / std::pow(2.0, level + 1);
+        if ((levels < 0 && coarse_sigma < 0.7) || (levels >= 0 && level >= levels)) {
+            break;
+        }
+        level++;
+    }
+    if (level == 0) {
+        apply_gaussian_smoothing(image, kernelSize, sigma);
+        return 0;
+    }
+
+    // 2. Shrink the kernel with the image and remove the blur the pyramid already contributes.
+    double scale = std::pow(2.0, level);
+    double coarse_sigma = std::sqrt(sigma * sigma - pyramid_variance(level)) / scale;
+    int coarse_radius = std::max(1, (int)std::lround((kernelSize / 2) / scale));
+    filter_at_level(image, level, kernelSize / 2, [&](GrayscaleImage& coarse) {
+        apply_gaussian_smoothing(coarse, 2 * coarse_radius + 1, coarse_sigma);
+    });
+    return level;
+}
+
+// Multi-scale Mean Filter
+int Filter::apply_mean_filter_multiscale(GrayscaleImage& image, int kernelSize, int levels) {
+    Profiler::Scope scope("mean_pyr", (long long)image.get_width() * image.get_height());
+    // A box of width k has variance (k^2 - 1) / 12, match it with the pyramid blur plus a coarse box.
+    double variance = (kernelSize * (double)kernelSize - 1.0) / 12.0;
+    auto coarse_size = [&](int level) {
+        double residual = variance - pyramid_variance(level);
+        if (residual <= 0) {
+            return 0;
+        }
+        double width = std::sqrt(12.0 * residual / std::pow(4.0, level) + 1.0);
+        return 2 * (int)std::lround((width - 1.0) / 2.0) + 1;
+    };
+
+    // 1. Pick the pyramid level, automatic mode keeps at least a 3x3 box at the coarse level.
+    int smallest_side = std::min(image.get_width(), image.get_height());
+    int level = 0;
+    while ((smallest_side >> (level + 1)) > 0 && coarse_size(level + 1) > 0) {
+        if ((levels < 0 && coarse_size(level + 1) < 3) || (levels >= 0 && level >= levels)) {
+            break;
+        }
+        level++;
+    }
+    if (level == 0) {
+        apply_mean_filter(image, kernelSize);
+        return 0;
+    }
+
+    // 2. Run the reduced box filter and expand back.
+    int coarse_kernel = coarse_size(level);
+    filter_at_level(image, level, kernelSize / 2, [&](GrayscaleImage& coarse) {
+        apply_mean_filter(coarse, coarse_kernel);
+    });
+    return level;
+}
+
+// Bilateral Filter through a bilateral grid
+void Filter::apply_bilateral_filter(GrayscaleImage& image, double spatialSigma, double rangeSigma) {
+    Profiler::Scope scope("bilateral", (long long)image.get_width() * image.get_height());
+    // Grid cells smaller than a pixel or a gray level only add memory, not precision
+    if (spatialSigma < 1 || rangeSigma < 1) {
+        throw std::invalid_argument("Bilateral sigmas must be at least 1.");
+    }
+    const int PADDING = 2; // blur radius in grid cells, keeps the blur inside the grid
+    int height = image.get_height();
+    int width = image.get_width();
+    int dims[3] = {
+        (int)((width - 1) / spatialSigma) + 1 + 2 * PADDING,
+        (int)((height - 1) / spatialSigma) + 1 + 2 * PADDING,
+        (int)(255 / rangeSigma) + 1 + 2 * PADDING
+    };
+    size_t cells = (size_t)dims[0] * dims[1] * dims[2];
+    std::vector<double> values(cells, 0.0), weights(cells, 0.0);
+    auto cell = [&](int gx, int gy, int gz) { return ((size_t)gz * dims[1] + gy) * dims[0] + gx; };
+    auto intensity = [](int pixel) { return std::min(255, std::max(0, pixel)); };
+
+    // 1. Splat: every pixel adds its value and a unit weight to the nearest grid cell.
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) {
+            int value = intensity(image.get_pixel(i, j));
+            size_t index = cell((int)(j / spatialSigma + 0.5) + PADDING, (int)(i / spatialSigma + 0.5) + PADDING,
+                                (int)(value / rangeSigma + 0.5) + PADDING);
+            values[index] += value;
+            weights[index] += 1.0;
+        }
+    }
+
+    // 2. Blur: a Gaussian with a sigma of one cell along x, y and intensity. The taps are the
+    //    factors of the smoothing filter's kernel; their scale cancels in values / weights.
+    std::vector<double> column, taps;
+    Convolution::separate(Convolution::gaussian_kernel(2 * PADDING + 1, 1.0), column, taps);
+    for (int axis = 0; axis < 3; axis++) {
+        blur_grid_axis(values, dims, axis, taps);
+        blur_grid_axis(weights, dims, axis, taps);
+    }
+
+    // 3. Slice: interpolate the grid trilinearly at each pixel's position and intensity.
+    GrayscaleImage copy_image = image;
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) {
+            int value = intensity(copy_image.get_pixel(i, j));
+            double position[3] = {j / spatialSigma + PADDING, i / spatialSigma + PADDING, value / rangeSigma + PADDING};
+            int base[3];
+            double fraction[3];
+            for (int axis = 0; axis < 3; axis++) {
+                base[axis] = std::min((int)position[axis], dims[axis] - 2);
+                fraction[axis] = position[axis] - base[axis];
+            }
+            double value_sum = 0, weight_sum = 0;
+            for (int corner = 0; corner < 8; corner++) {
+                double factor = 1.0;
+                int offset[3];
+                for (int axis = 0; axis < 3; axis++) {
+                    offset[axis] = (corner >> axis) & 1;
+                    factor *= offset[axis] ? fraction[axis] : 1.0 - fraction[axis];
+                }
+                size_t index = cell(base[0] + offset[0], base[1] + offset[1], base[2] + offset[2]);
+                value_sum += factor * values[index];
+                weight_sum += factor * weights[index];
+            }
+            int filtered = (weight_sum > 0) ? (int)(value_sum / weight_sum + 0.5) : value;
+            image.set_pixel(i, j, intensity(filtered));
+        }
+    }
+}
+
+// Erosion with a rectangular structuring element: minimum over the element centred on each pixel
+void Filter::apply_erosion(GrayscaleImage& image, int elementWidth, int elementHeight) {
+    if (elementWidth < 1 || elementHeight < 1) {
+        throw std::invalid_argument("Structuring element must be at least 1x1.");
+    }
+    Profiler::Scope scope("erode", (long long)image.get_width() * image.get_height());
+    rectangle_morphology<MinimumOperation>(image, elementWidth, elementHeight, elementWidth / 2, elementHeight / 2);
+}
+
+// Dilation: maximum over the reflected element, so opening and closing are exact for even sizes too
+void Filter::apply_dilation(GrayscaleImage& image, int elementWidth, int elementHeight) {
+    if (elementWidth < 1 || elementHeight < 1) {
+        throw std::invalid_argument("Structuring element must be at least 1x1.");
+    }
+    Profiler::Scope scope("dilate", (long long)image.get_width() * image.get_height());
+    rectangle_morphology<MaximumOperation>(image, elementWidth, elementHeight,
+                                           elementWidth - 1 - elementWidth / 2, elementHeight - 1 - elementHeight / 2);
+}
+
+// Opening: erosion then dilation, removes bright details smaller than the element
+void Filter::apply_opening(GrayscaleImage& image, int elementWidth, int elementHeight) {
+    apply_erosion(image, elementWidth, elementHeight);
+    apply_dilation(image, elementWidth, elementHeight);
+}
+
+// Closing: dilation then erosion, fills dark details smaller than the element
+void Filter::apply_closing(GrayscaleImage& image, int elementWidth, int elementHeight) {
+    apply_dilation(image, elementWidth, elementHeight);
+    apply_erosion(image, elementWidth, elementHeight);
+}
+
+// Morphological gradient: dilation minus erosion, highlights edges
+void Filter::apply_morphological_gradient(GrayscaleImage& image, int elementWidth, int elementHeight) {
+    GrayscaleImage eroded_image = image;
+    apply_erosion(eroded_image, elementWidth, elementHeight);
+    apply_dilation(image, elementWidth, elementHeight);
+    image = image - eroded_image;
+}
+
+// Rank Filter (Perreault-Hebert constant time median generalised to any percentile)
+void Filter::apply_rank_filter(GrayscaleImage& image, int kernelSize, double percentile) {
+    apply_rank_filter(GrayscaleImageView(image), kernelSize, percentile);
+}
+
+// Rank Filter of a region: windows extend into the surrounding image, results are written into the region only
+void Filter::apply_rank_filter(GrayscaleImageView view, int kernelSize, double percentile) {
+    Profiler::Scope scope("rank", (long long)view.get_width() * view.get_height());
+    if (kernelSize < 1) {
+        throw std::invalid_argument("Kernel size must be positive.");
+    }
+    if (percentile < 0.0 || percentile > 1.0) {
+        throw std::invalid_argument("Percentile must be between 0 and 1.");
+    }
+    const int BINS = 256;      // fine histogram, one bin per gray level
+    const int COARSE = 16;     // coarse histogram, one bin per 16 gray levels
+    const int SHIFT = 4;
+    const int SEGMENT = BINS / COARSE;
+
+    GrayscaleImage& image = view.get_image();
+    int height = image.get_height();
+    int width = image.get_width();
+    // Window rows [i - before, i + after] and the same for columns; an even size extends one
+    // pixel less after the centre, like the mean filter's kernel.
+    int before = kernelSize / 2, after = kernelSize - 1 - kernelSize / 2;
+    int** pixels = image.get_data();
+    int top = view.get_y(), left = view.get_x();
+    int bottom = top + view.get_height(), right = left + view.get_width();
+
+    // Results go to a separate image so every window reads the unfiltered pixels
+    GrayscaleImage result(view.get_width(), view.get_height());
+
+    // 1. One histogram per column covering the rows of the current window, for the columns
+    //    the region's windows reach. Windows are clipped at the image border, so only real pixels are ranked.
+    int first_column = std::max(0, left - before), last_column = std::min(width, right + after);
+    int columns = std::max(0, last_column - first_column);
+    std::vector<int> column_fine(columns * BINS, 0);
+    std::vector<int> column_coarse(columns * COARSE, 0);
+    auto update_row = [&](int row, int delta) {
+        for (int j = first_column; j < last_column; j++) {
+            int value = std::min(255, std::max(0, pixels[row][j]));
+            column_fine[(j - first_column) * BINS + value] += delta;
+            column_coarse[(j - first_column) * COARSE + (value >> SHIFT)] += delta;
+        }
+    };
+    for (int row = std::max(0, top - before); row < std::min(top + after, height); row++) {
+        update_row(row, 1);
+    }
+
+    // The kernel's coarse histogram always follows the window. Each fine segment (the 16 gray levels
+    // of one coarse bin) covers its own column range [segment_first, segment_last) and is only
+    // brought up to the current window when the rank falls into that coarse bin.
+    std::vector<int> kernel_fine(BINS), kernel_coarse(COARSE);
+    std::vector<int> segment_first(COARSE), segment_last(COARSE);
+    auto update_coarse = [&](int column, int delta) {
+        const int* coarse = &column_coarse[(column - first_column) * COARSE];
+        for (int b = 0; b < COARSE; b++) kernel_coarse[b] += delta * coarse[b];
+    };
+    auto update_segment = [&](int segment, int column, int delta) {
+        // Columns without pixels in this coarse bin have an all-zero segment
+        if (column_coarse[(column - first_column) * COARSE + segment] == 0) return;
+        const int* fine = &column_fine[(column - first_column) * BINS + segment * SEGMENT];
+        int* target = &kernel_fine[segment * SEGMENT];
+        for (int b = 0; b < SEGMENT; b++) target[b] += delta * fine[b];
+    };
+    auto refresh_segment = [&](int segment, int first, int last) {
+        if (segment_last[segment] <= first) {
+            // No overlap with the old range, start the segment over
+            std::fill(&kernel_fine[segment * SEGMENT], &kernel_fine[segment * SEGMENT] + SEGMENT, 0);
+            segment_first[segment] = segment_last[segment] = first;
+        }
+        for (int column = segment_first[segment]; column < first; column++) update_segment(segment, column, -1);
+        for (int column = segment_last[segment]; column < last; column++) update_segment(segment, column, 1);
+        segment_first[segment] = first;
+        segment_last[segment] = last;
+    };
+
+    for (int i = top; i < bottom; i++) {
+        // 2. Slide every column histogram down by one row.
+        if (i > top && i - before - 1 >= 0) update_row(i - before - 1, -1);
+        if (i + after < height) update_row(i + after, 1);
+        int window_rows = std::min(height - 1, i + after) - std::max(0, i - before) + 1;
+
+        // 3. Build the coarse kernel histogram for the first window of the row, the fine segments start empty.
+        std::fill(kernel_coarse.begin(), kernel_coarse.end(), 0);
+        for (int column = std::max(0, left - before); column <= std::min(left + after, width - 1); column++) {
+            update_coarse(column, 1);
+        }
+        std::fill(kernel_fine.begin(), kernel_fine.end(), 0);
+        std::fill(segment_first.begin(), segment_first.end(), first_column);
+        std::fill(segment_last.begin(), segment_last.end(), first_column);
+
+        for (int j = left; j < right; j++) {
+            // 4. Slide the coarse histogram right: add the entering column, remove the leaving one.
+            if (j > left) {
+                if (j + after < width) update_coarse(j + after, 1);
+                if (j - before - 1 >= 0) update_coarse(j - before - 1, -1);
+            }
+            int window_first = std::max(0, j - before), window_last = std::min(width, j + after + 1);
+            int rank = (int)(percentile * (window_rows * (window_last - window_first) - 1));
+
+            // 5. Find the coarse bin holding the requested rank, update only its fine segment and search it.
+            int coarse_bin = 0, seen = 0;
+            while (seen + kernel_coarse[coarse_bin] <= rank) {
+                seen += kernel_coarse[coarse_bin++];
+            }
+            refresh_segment(coarse_bin, window_first, window_last);
+            int value = coarse_bin << SHIFT;
+            while (seen + kernel_fine[value] <= rank) {
+                seen += kernel_fine[value++];
+            }
+            result.set_pixel(i - top, j - left, value);
+        }
+    }
+    view.assign(result);
+}
+
+// Median Filter
+void Filter::apply_median_filter(GrayscaleImage& image, int kernelSize) {
+    apply_rank_filter(image, kernelSize, 0.5);
+}
+
+// Median Filter of a region
+void Filter::apply_median_filter(GrayscaleImageView view, int kernelSize) {
+    apply_rank_filter(view, kernelSize, 0.5);
+}
+
+// Min Filter
+void Filter::apply_min_filter(GrayscaleImage& image, int kernelSize) {
+    apply_rank_filter(image, kernelSize, 0.0);
+}
+
+// Max Filter
+void Filter::apply_max_filter(GrayscaleImage& image, int kernelSize) {
+    apply_rank_filter(image, kernelSize, 1.0);
+}
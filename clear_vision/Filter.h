@@ -2,6 +2,7 @@
 #define FILTER_H
 
 #include "GrayscaleImage.h"
+#include "GrayscaleImageView.h"
 
 class Filter {
 public:
@@ -13,6 +14,52 @@ public:
 
     // Apply Unsharp Masking Filter
     static void apply_unsharp_mask(GrayscaleImage& image, int kernelSize = 3, double amount = 1.5);
+
+    // Region versions of the filters above: only the view's pixels change, windows that cross the
+    // region's border read the surrounding image, so the region matches the whole-image result.
+    static void apply_mean_filter(GrayscaleImageView view, int kernelSize = 3);
+    static void apply_gaussian_smoothing(GrayscaleImageView view, int kernelSize = 3, double sigma = 1.0);
+    static void apply_unsharp_mask(GrayscaleImageView view, int kernelSize = 3, double amount = 1.5);
+
+    // Unsharp mask of an image whose blur is already known, several amounts can share one blur
+    static GrayscaleImage sharpen(const GrayscaleImage& original, const GrayscaleImage& blurred, double amount);
+
+    // Multi-scale Gaussian Smoothing: runs the filter on a reduced level of a Gaussian pyramid and
+    // upsamples back. levels = 0 is the exact filter, each extra level trades accuracy for roughly 4x
+    // less work, and levels < 0 picks the coarsest level that still resolves sigma. Returns the level used.
+    // Like the exact filter, pixels outside the image count as zero.
+    static int apply_gaussian_smoothing_multiscale(GrayscaleImage& image, int kernelSize = 3, double sigma = 1.0, int levels = -1);
+
+    // Multi-scale Mean Filter, with the same meaning of levels as the Gaussian version
+    static int apply_mean_filter_multiscale(GrayscaleImage& image, int kernelSize = 3, int levels = -1);
+
+    // Apply an edge-preserving Bilateral Filter: pixels are averaged with Gaussian weights over both
+    // distance (spatialSigma, in pixels) and intensity difference (rangeSigma, in gray levels).
+    // Runs on a downsampled bilateral grid, so the cost barely depends on spatialSigma. Both sigmas must be at least 1.
+    static void apply_bilateral_filter(GrayscaleImage& image, double spatialSigma = 8.0, double rangeSigma = 20.0);
+
+    // Apply a Rank Filter: percentile 0 selects the minimum, 0.5 the median and 1 the maximum
+    // of each kernelSize x kernelSize window. Cost per pixel does not depend on the kernel size.
+    // Windows are placed like the mean filter's kernel: rows and columns from -kernelSize / 2
+    // to kernelSize - 1 - kernelSize / 2 around the pixel, so even sizes are asymmetric.
+    static void apply_rank_filter(GrayscaleImage& image, int kernelSize = 3, double percentile = 0.5);
+    static void apply_rank_filter(GrayscaleImageView view, int kernelSize = 3, double percentile = 0.5);
+
+    // Apply the Median Filter
+    static void apply_median_filter(GrayscaleImage& image, int kernelSize = 3);
+    static void apply_median_filter(GrayscaleImageView view, int kernelSize = 3);
+
+    // Apply the Min (erosion-like) and Max (dilation-like) Rank Filters
+    static void apply_min_filter(GrayscaleImage& image, int kernelSize = 3);
+    static void apply_max_filter(GrayscaleImage& image, int kernelSize = 3);
+
+    // Morphology with an elementWidth x elementHeight rectangle (van Herk/Gil-Werman, separable):
+    // about three comparisons per pixel and pass whatever the element size. Pixels outside the image are ignored.
+    static void apply_erosion(GrayscaleImage& image, int elementWidth = 3, int elementHeight = 3);
+    static void apply_dilation(GrayscaleImage& image, int elementWidth = 3, int elementHeight = 3);
+    static void apply_opening(GrayscaleImage& image, int elementWidth = 3, int elementHeight = 3);
+    static void apply_closing(GrayscaleImage& image, int elementWidth = 3, int elementHeight = 3);
+    static void apply_morphological_gradient(GrayscaleImage& image, int elementWidth = 3, int elementHeight = 3);
 };
 
 #endif // FILTER_H
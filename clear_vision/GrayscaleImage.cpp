@@ -1,4 +1,5 @@
 #include "GrayscaleImage.h"
+#include "Profiler.h"
 #include <iostream>
 #include <cstring>  // For memcpy
 #define STB_IMAGE_IMPLEMENTATION
@@ -6,6 +7,9 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 #include <stdexcept>
+#include <string>
+#include <algorithm>
+#include <cmath>
 
 
 // Constructor: load from a file
@@ -34,6 +38,23 @@ GrayscaleImage::GrayscaleImage(const char* filename) {
     stbi_image_free(image);
 }
 
+// Load from a file, reporting failure with an exception so callers can carry on with other files
+GrayscaleImage GrayscaleImage::load(const char* filename) {
+    int w, h, channels;
+    unsigned char* image = stbi_load(filename, &w, &h, &channels, STBI_grey);
+    if (image == nullptr) {
+        throw std::runtime_error(std::string("Could not load image ") + filename);
+    }
+    GrayscaleImage result(w, h);
+    for (int i = 0; i < h; i++) {
+        for (int j = 0; j < w; j++) {
+            result.data[i][j] = image[i * w + j];
+        }
+    }
+    stbi_image_free(image);
+    return result;
+}
+
 // Constructor: initialize from a pre-existing data matrix
 GrayscaleImage::GrayscaleImage(int** inputData, int h, int w) {
     // Don't forget to dynamically allocate memory for the matrix.
@@ -87,8 +108,33 @@ GrayscaleImage::~GrayscaleImage() {
     delete[] data;
 }
 
+// Copy assignment operator
+GrayscaleImage& GrayscaleImage::operator=(const GrayscaleImage& other) {
+    if (this == &other) {
+        return *this;
+    }
+    // Reallocate only when the dimensions differ
+    if (width != other.width || height != other.height) {
+        for (int i = 0; i < height; i++) {
+            delete[] data[i];
+        }
+        delete[] data;
+        width = other.width;
+        height = other.height;
+        data = new int*[height];
+        for (int i = 0; i < height; i++) {
+            data[i] = new int[width];
+        }
+    }
+    for (int i = 0; i < height; i++) {
+        std::copy(other.data[i], other.data[i] + width, data[i]);
+    }
+    return *this;
+}
+
 // Equality operator
 bool GrayscaleImage::operator==(const GrayscaleImage& other) const {
+    Profiler::Scope scope("equals", (long long)width * height);
     // Check if two images have the same dimensions and pixel values.
     // If they do, return true.
     if ( (get_height() != other.get_height()) || (get_width() != other.get_width())) {
@@ -107,6 +153,7 @@ bool GrayscaleImage::operator==(const GrayscaleImage& other) const {
 
 // Addition operator
 GrayscaleImage GrayscaleImage::operator+(const GrayscaleImage& other) const {
+    Profiler::Scope scope("add", (long long)width * height);
     // Create a new image for the result
     GrayscaleImage result(width, height);
     
@@ -127,6 +174,7 @@ GrayscaleImage GrayscaleImage::operator+(const GrayscaleImage& other) const {
 
 // Subtraction operator
 GrayscaleImage GrayscaleImage::operator-(const GrayscaleImage& other) const {
+    Profiler::Scope scope("sub", (long long)width * height);
     // Create a new image for the result
     GrayscaleImage result(width, height);
     
@@ -146,6 +194,99 @@ GrayscaleImage GrayscaleImage::operator-(const GrayscaleImage& other) const {
     return result;
 }
 
+// Downsample to half size after a [1 4 6 4 1] / 16 blur in both directions
+GrayscaleImage GrayscaleImage::downsample() const {
+    static const int taps[5] = {1, 4, 6, 4, 1};
+    int half_width = (width + 1) / 2;
+    int half_height = (height + 1) / 2;
+
+    // 1. Blur rows and keep every second column, clamping at the borders.
+    std::vector<int> rows(height * half_width);
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < half_width; j++) {
+            int total = 0;
+            for (int t = 0; t < 5; t++) {
+                int column = std::min(width - 1, std::max(0, 2 * j + t - 2));
+                total += taps[t] * data[i][column];
+            }
+            rows[i * half_width + j] = total;
+        }
+    }
+
+    // 2. Blur columns and keep every second row, rounding back to the pixel range.
+    GrayscaleImage result(half_width, half_height);
+    for (int i = 0; i < half_height; i++) {
+        for (int j = 0; j < half_width; j++) {
+            int total = 0;
+            for (int t = 0; t < 5; t++) {
+                int row = std::min(height - 1, std::max(0, 2 * i + t - 2));
+                total += taps[t] * rows[row * half_width + j];
+            }
+            result.data[i][j] = (total + 128) / 256;
+        }
+    }
+    return result;
+}
+
+// Upsample with bilinear interpolation, pixel (i, j) of the result sits at (i / 2, j / 2) here
+GrayscaleImage GrayscaleImage::upsample(int w, int h) const {
+    GrayscaleImage result(w, h);
+    for (int i = 0; i < h; i++) {
+        int row0 = std::min(height - 1, i / 2);
+        int row1 = std::min(height - 1, row0 + 1);
+        int row_weight = i % 2; // 0 on a source row, 1 halfway between two
+        for (int j = 0; j < w; j++) {
+            int column0 = std::min(width - 1, j / 2);
+            int column1 = std::min(width - 1, column0 + 1);
+            int column_weight = j % 2;
+            int total = (2 - row_weight) * ((2 - column_weight) * data[row0][column0] + column_weight * data[row0][column1])
+                      + row_weight * ((2 - column_weight) * data[row1][column0] + column_weight * data[row1][column1]);
+            result.data[i][j] = (total + 2) / 4;
+        }
+    }
+    return result;
+}
+
+// Build a Gaussian pyramid with the given number of reduced levels
+std::vector<GrayscaleImage> GrayscaleImage::build_pyramid(int levels) const {
+    std::vector<GrayscaleImage> pyramid;
+    pyramid.reserve(levels + 1);
+    pyramid.push_back(*this);
+    for (int level = 1; level <= levels; level++) {
+        pyramid.push_back(pyramid.back().downsample());
+    }
+    return pyramid;
+}
+
+// Largest absolute pixel difference
+int GrayscaleImage::max_difference(const GrayscaleImage& other) const {
+    if (width != other.width || height != other.height) {
+        throw std::invalid_argument("Images must have the same dimensions.");
+    }
+    int max_error = 0;
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) {
+            max_error = std::max(max_error, std::abs(data[i][j] - other.data[i][j]));
+        }
+    }
+    return max_error;
+}
+
+// Root mean square pixel difference
+double GrayscaleImage::rms_difference(const GrayscaleImage& other) const {
+    if (width != other.width || height != other.height) {
+        throw std::invalid_argument("Images must have the same dimensions.");
+    }
+    double total = 0;
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) {
+            double difference = data[i][j] - other.data[i][j];
+            total += difference * difference;
+        }
+    }
+    return (width * height > 0) ? std::sqrt(total / (width * height)) : 0.0;
+}
+
 // Get a specific pixel value
 int GrayscaleImage::get_pixel(int row, int col) const {
     return data[row][col];
@@ -158,21 +299,27 @@ void GrayscaleImage::set_pixel(int row, int col, int value) {
 
 // Function to save the image to a PNG file
 void GrayscaleImage::save_to_file(const char* filename) const {
+    try {
+        save(filename);
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
+}
+
+// Write to a PNG file, reporting failure with an exception so callers can count it as an error
+void GrayscaleImage::save(const char* filename) const {
     // Create a buffer to hold the image data in the format stb_image_write expects
-    unsigned char* imageBuffer = new unsigned char[width * height];
+    std::vector<unsigned char> imageBuffer((size_t)width * height);
 
     // Fill the buffer with pixel data (convert int to unsigned char)
     for (int i = 0; i < height; ++i) {
         for (int j = 0; j < width; ++j) {
-            imageBuffer[i * width + j] = static_cast<unsigned char>(data[i][j]);
+            imageBuffer[(size_t)i * width + j] = static_cast<unsigned char>(data[i][j]);
         }
     }
 
     // Write the buffer to a PNG file
-    if (!stbi_write_png(filename, width, height, 1, imageBuffer, width)) {
-        std::cerr << "Error: Could not save image to file " << filename << std::endl;
+    if (!stbi_write_png(filename, width, height, 1, imageBuffer.data(), width)) {
+        throw std::runtime_error(std::string("Could not save image to file ") + filename);
     }
-
-    // Clean up the allocated buffer
-    delete[] imageBuffer;
 }
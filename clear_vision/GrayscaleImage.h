@@ -1,6 +1,8 @@
 #ifndef GRAYSCALE_IMAGE_H
 #define GRAYSCALE_IMAGE_H
 
+#include <vector>
+
 class GrayscaleImage {
 private:
     int** data;
@@ -11,6 +13,10 @@ public:
     // Constructor: loads an image from a file
     GrayscaleImage(const char* filename);
 
+    // Loads an image from a file like the constructor, but throws std::runtime_error
+    // instead of exiting when the file can't be read
+    static GrayscaleImage load(const char* filename);
+
     // Constructor: initializes from a 2D data matrix
     GrayscaleImage(int** inputData, int h, int w);
 
@@ -23,6 +29,9 @@ public:
     // Destructor
     ~GrayscaleImage();
 
+    // Copy assignment operator
+    GrayscaleImage& operator=(const GrayscaleImage& other);
+
     // Operator overloads
     bool operator==(const GrayscaleImage& other) const;
     GrayscaleImage operator+(const GrayscaleImage& other) const;
@@ -38,9 +47,25 @@ public:
     // Set a specific pixel value
     void set_pixel(int row, int col, int value);
 
+    // Blur with the 5-tap binomial kernel and keep every second row and column
+    GrayscaleImage downsample() const;
+
+    // Bilinearly expand a downsampled image back to the given size
+    GrayscaleImage upsample(int w, int h) const;
+
+    // Gaussian pyramid: level 0 is a copy of this image, each further level is half the size
+    std::vector<GrayscaleImage> build_pyramid(int levels) const;
+
+    // Largest absolute and root mean square pixel difference to an image of the same size
+    int max_difference(const GrayscaleImage& other) const;
+    double rms_difference(const GrayscaleImage& other) const;
+
     // Function to write the image data back to a PNG file
     void save_to_file(const char* filename) const;
 
+    // Same, but throws std::runtime_error when the file can't be written
+    void save(const char* filename) const;
+
     // Getter function for data.
     int** get_data() const {
         return data;
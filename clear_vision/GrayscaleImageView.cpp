@@ -0,0 +1,99 @@
+#include "GrayscaleImageView.h"
+#include <algorithm>
+#include <stdexcept>
+
+// Constructor: view of the whole image
+GrayscaleImageView::GrayscaleImageView(GrayscaleImage& image)
+    : image(&image), x(0), y(0), width(image.get_width()), height(image.get_height()) {}
+
+// Constructor: view of a region inside the image
+GrayscaleImageView::GrayscaleImageView(GrayscaleImage& image, int x, int y, int w, int h)
+    : image(&image), x(x), y(y), width(w), height(h) {
+    if (w < 1 || h < 1) {
+        throw std::invalid_argument("Region of interest must not be empty.");
+    }
+    if (x < 0 || y < 0 || x + w > image.get_width() || y + h > image.get_height()) {
+        throw std::out_of_range("Region of interest lies outside the image.");
+    }
+}
+
+// Get a pixel relative to the region
+int GrayscaleImageView::get_pixel(int row, int col) const {
+    return image->get_pixel(y + row, x + col);
+}
+
+// Set a pixel relative to the region
+void GrayscaleImageView::set_pixel(int row, int col, int value) {
+    image->set_pixel(y + row, x + col, value);
+}
+
+// Start of a region row inside the parent's row storage
+int* GrayscaleImageView::row_data(int row) const {
+    return image->get_data()[y + row] + x;
+}
+
+// Copy the region into a new image
+GrayscaleImage GrayscaleImageView::to_image() const {
+    GrayscaleImage result(width, height);
+    for (int i = 0; i < height; i++) {
+        std::copy(row_data(i), row_data(i) + width, result.get_data()[i]);
+    }
+    return result;
+}
+
+// Overwrite the region with a patch of the same size
+void GrayscaleImageView::assign(const GrayscaleImage& patch) {
+    if (patch.get_width() != width || patch.get_height() != height) {
+        throw std::invalid_argument("Patch size does not match the region of interest.");
+    }
+    for (int i = 0; i < height; i++) {
+        std::copy(patch.get_data()[i], patch.get_data()[i] + width, row_data(i));
+    }
+}
+
+// Equality operator: same region size and pixel values
+bool GrayscaleImageView::operator==(const GrayscaleImageView& other) const {
+    if (height != other.height || width != other.width) {
+        return false;
+    }
+    for (int i = 0; i < height; i++) {
+        if (!std::equal(row_data(i), row_data(i) + width, other.row_data(i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Addition operator: clamped sum of two regions of the same size
+GrayscaleImage GrayscaleImageView::operator+(const GrayscaleImageView& other) const {
+    if (height != other.height || width != other.width) {
+        throw std::invalid_argument("Regions must have the same dimensions.");
+    }
+    GrayscaleImage result(width, height);
+    for (int i = 0; i < height; i++) {
+        const int* left = row_data(i);
+        const int* right = other.row_data(i);
+        int* target = result.get_data()[i];
+        for (int j = 0; j < width; j++) {
+            target[j] = std::min(255, std::max(0, left[j] + right[j]));
+        }
+    }
+    return result;
+}
+
+// Subtraction operator: clamped difference of two regions of the same size
+GrayscaleImage GrayscaleImageView::operator-(const GrayscaleImageView& other) const {
+    if (height != other.height || width != other.width) {
+        throw std::invalid_argument("Regions must have the same dimensions.");
+    }
+    GrayscaleImage result(width, height);
+    for (int i = 0; i < height; i++) {
+        const int* left = row_data(i);
+        const int* right = other.row_data(i);
+        int* target = result.get_data()[i];
+        for (int j = 0; j < width; j++) {
+            target[j] = std::min(255, std::max(0, left[j] - right[j]));
+        }
+    }
+    return result;
+}
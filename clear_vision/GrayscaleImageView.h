@@ -0,0 +1,49 @@
+#ifndef GRAYSCALE_IMAGE_VIEW_H
+#define GRAYSCALE_IMAGE_VIEW_H
+
+#include "GrayscaleImage.h"
+
+// Non-owning view of a rectangular region (x, y, width, height) of a GrayscaleImage.
+// Pixels are addressed relative to the region; the parent image stays reachable so
+// filters can read the halo around the region while writing only inside it.
+class GrayscaleImageView {
+private:
+    GrayscaleImage* image;
+    int x, y, width, height;
+
+public:
+    // Constructor: view of the whole image
+    GrayscaleImageView(GrayscaleImage& image);
+
+    // Constructor: view of a region, which must be non-empty and lie inside the image
+    GrayscaleImageView(GrayscaleImage& image, int x, int y, int w, int h);
+
+    // Region position and dimensions
+    int get_x() const { return x; }
+    int get_y() const { return y; }
+    int get_width() const { return width; }
+    int get_height() const { return height; }
+
+    // The image this view looks into
+    GrayscaleImage& get_image() const { return *image; }
+
+    // Get and set a pixel relative to the region
+    int get_pixel(int row, int col) const;
+    void set_pixel(int row, int col, int value);
+
+    // Pointer to the first pixel of a region row, consecutive columns are contiguous
+    int* row_data(int row) const;
+
+    // Copies the region out into a new image
+    GrayscaleImage to_image() const;
+
+    // Overwrites the region with an image of the same size
+    void assign(const GrayscaleImage& patch);
+
+    // Operator overloads, the same semantics as GrayscaleImage applied to the regions
+    bool operator==(const GrayscaleImageView& other) const;
+    GrayscaleImage operator+(const GrayscaleImageView& other) const;
+    GrayscaleImage operator-(const GrayscaleImageView& other) const;
+};
+
+#endif // GRAYSCALE_IMAGE_VIEW_H
@@ -0,0 +1,249 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Order of the hardware counters in every array below
+enum CounterIndex { CYCLES, INSTRUCTIONS, L1_MISSES, LLC_MISSES, BRANCH_MISSES };
+const int COUNTER_COUNT = Profiler::COUNTER_COUNT;
+
+const char* COUNTER_NAMES[COUNTER_COUNT] = {"cycles", "instructions", "L1d misses", "LLC misses", "branch misses"};
+
+// Totals of one operation
+struct OperationTotals {
+    long long calls;
+    long long pixels;
+    double seconds;
+    long long counts[COUNTER_COUNT];
+
+    OperationTotals() : calls(0), pixels(0), seconds(0) {
+        std::fill(counts, counts + COUNTER_COUNT, 0LL);
+    }
+};
+
+bool profiling_enabled = false;
+// Counters the kernel accepted when profiling was enabled; cleared if a thread later can't open one
+std::atomic<bool> counter_available[COUNTER_COUNT];
+std::mutex totals_mutex;
+std::map<std::string, OperationTotals>& totals() {
+    static std::map<std::string, OperationTotals> operations;
+    return operations;
+}
+
+double now_seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#ifdef __linux__
+// One user-space counter for the calling thread only
+int open_counter(int counter) {
+    static const uint32_t types[COUNTER_COUNT] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+                                                  PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE};
+    static const uint64_t configs[COUNTER_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+    struct perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = types[counter];
+    attr.config = configs[counter];
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+// Counter descriptors of one thread, opened on first use and closed when the thread ends
+struct ThreadCounters {
+    int fds[COUNTER_COUNT];
+    bool opened;
+
+    ThreadCounters() : opened(false) {
+        std::fill(fds, fds + COUNTER_COUNT, -1);
+    }
+
+    ~ThreadCounters() {
+#ifdef __linux__
+        for (int fd : fds) {
+            if (fd >= 0) close(fd);
+        }
+#endif
+    }
+
+    void open_available() {
+        opened = true;
+#ifdef __linux__
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            if (!counter_available[c]) continue;
+            fds[c] = open_counter(c);
+            if (fds[c] < 0) counter_available[c] = false;
+        }
+#endif
+    }
+};
+
+thread_local ThreadCounters thread_counters;
+thread_local Profiler::Scope* innermost_scope = nullptr;
+
+// Current value of the calling thread's counters, -1 for counters that are not available
+void read_counters(long long* values) {
+    if (!thread_counters.opened) {
+        thread_counters.open_available();
+    }
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        values[c] = -1;
+#ifdef __linux__
+        long long value;
+        if (thread_counters.fds[c] >= 0 && read(thread_counters.fds[c], &value, sizeof(value)) == (ssize_t)sizeof(value)) {
+            values[c] = value;
+        }
+#endif
+    }
+}
+
+} // namespace
+
+// Start a measurement when profiling is enabled
+Profiler::Scope::Scope(const char* operation, long long pixel_count)
+    : active(profiling_enabled), pixels(pixel_count), start_seconds(0), enclosing(nullptr) {
+    if (!active) {
+        return;
+    }
+    name = operation;
+    for (int c = 0; c < COUNTER_COUNT; c++) attached_counts[c] = 0;
+    enclosing = innermost_scope;
+    innermost_scope = this;
+    read_counters(start_counts);
+    start_seconds = now_seconds();
+}
+
+// Add the elapsed time and the counter deltas of this thread and its helpers to the operation's totals
+Profiler::Scope::~Scope() {
+    if (!active) {
+        return;
+    }
+    double elapsed = now_seconds() - start_seconds;
+    long long end_counts[COUNTER_COUNT];
+    read_counters(end_counts);
+    innermost_scope = enclosing;
+
+    std::lock_guard<std::mutex> lock(totals_mutex);
+    OperationTotals& operation = totals()[name];
+    operation.calls++;
+    operation.pixels += pixels;
+    operation.seconds += elapsed;
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        if (start_counts[c] >= 0 && end_counts[c] >= 0) {
+            operation.counts[c] += end_counts[c] - start_counts[c] + attached_counts[c];
+        }
+    }
+    // Nested operations of the same thread get the helper counts too
+    if (enclosing != nullptr) {
+        for (int c = 0; c < COUNTER_COUNT; c++) enclosing->attached_counts[c] += attached_counts[c];
+    }
+}
+
+// Start counting a helper thread for the parent scope
+Profiler::Attach::Attach(Scope* scope) : parent(scope) {
+    if (parent == nullptr) {
+        return;
+    }
+    read_counters(start_counts);
+}
+
+Profiler::Attach::~Attach() {
+    if (parent == nullptr) {
+        return;
+    }
+    long long end_counts[COUNTER_COUNT];
+    read_counters(end_counts);
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        if (start_counts[c] >= 0 && end_counts[c] >= 0) parent->attached_counts[c] += end_counts[c] - start_counts[c];
+    }
+}
+
+Profiler::Scope* Profiler::current_scope() {
+    return innermost_scope;
+}
+
+// Probe which counters the kernel allows; every thread opens its own copies on first use
+void Profiler::enable() {
+    if (profiling_enabled) {
+        return;
+    }
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+#ifdef __linux__
+        int fd = open_counter(c);
+        counter_available[c] = fd >= 0;
+        if (fd >= 0) close(fd);
+#else
+        counter_available[c] = false;
+#endif
+    }
+    profiling_enabled = true;
+}
+
+bool Profiler::enabled() {
+    return profiling_enabled;
+}
+
+bool Profiler::counters_available() {
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        if (counter_available[c]) return true;
+    }
+    return false;
+}
+
+// Print one line per operation. Nested operations (unsharp runs a Gaussian) are included in their callers.
+void Profiler::report(std::ostream& out) {
+    if (!profiling_enabled) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(totals_mutex);
+    if (!counters_available()) {
+        out << "Hardware counters unavailable (perf_event_open refused), reporting timers only." << std::endl;
+    } else {
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            if (!counter_available[c]) out << "Counter unavailable: " << COUNTER_NAMES[c] << std::endl;
+        }
+    }
+
+    out << std::left << std::setw(14) << "operation" << std::right << std::setw(7) << "calls" << std::setw(12) << "pixels"
+        << std::setw(11) << "seconds" << std::setw(9) << "ns/px" << std::setw(7) << "IPC" << std::setw(10) << "L1d/px"
+        << std::setw(10) << "LLC/px" << std::setw(10) << "br-mis/px" << std::endl;
+    for (const auto& entry : totals()) {
+        const OperationTotals& operation = entry.second;
+        double pixels = operation.pixels > 0 ? (double)operation.pixels : 1.0;
+        auto per_pixel = [&](int counter) {
+            std::ostringstream text;
+            if (!counter_available[counter]) text << "n/a";
+            else text << std::fixed << std::setprecision(3) << operation.counts[counter] / pixels;
+            return text.str();
+        };
+        std::ostringstream ipc;
+        if (!counter_available[CYCLES] || !counter_available[INSTRUCTIONS] || operation.counts[CYCLES] == 0) ipc << "n/a";
+        else ipc << std::fixed << std::setprecision(2) << (double)operation.counts[INSTRUCTIONS] / operation.counts[CYCLES];
+
+        out << std::left << std::setw(14) << entry.first << std::right << std::setw(7) << operation.calls
+            << std::setw(12) << operation.pixels << std::setw(11) << std::fixed << std::setprecision(5) << operation.seconds
+            << std::setw(9) << std::setprecision(2) << operation.seconds * 1e9 / pixels << std::setw(7) << ipc.str()
+            << std::setw(10) << per_pixel(L1_MISSES) << std::setw(10) << per_pixel(LLC_MISSES)
+            << std::setw(10) << per_pixel(BRANCH_MISSES) << std::endl;
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <ostream>
+#include <string>
+
+// Optional profiling of the hot loops. Each instrumented operation opens a Scope; while the
+// profiler is enabled the scope adds its wall time and, where Linux perf_event_open is allowed,
+// its hardware counters (cycles, instructions, L1 data and last level cache misses, branch
+// misses) to a per-operation total. Without counter access only the timers are reported.
+// Disabled scopes cost a single flag check.
+//
+// Counters are opened per thread, so a scope only counts its own thread and scopes running
+// at the same time on other threads (batch and sweep workers) don't mix. Helper threads that
+// work for a scope add their counts to it through an Attach.
+class Profiler {
+public:
+    enum { COUNTER_COUNT = 5 };
+
+    // Measures the enclosing block as one call of the named operation over the given pixels
+    class Scope {
+    private:
+        bool active;
+        std::string name;
+        long long pixels;
+        double start_seconds;
+        long long start_counts[COUNTER_COUNT];
+        std::atomic<long long> attached_counts[COUNTER_COUNT];
+        Scope* enclosing;
+
+        friend class Profiler;
+
+    public:
+        Scope(const char* name, long long pixels);
+        ~Scope();
+    };
+
+    // Counts the enclosing block of a helper thread towards the scope that started it (may be null)
+    class Attach {
+    private:
+        Scope* parent;
+        long long start_counts[COUNTER_COUNT];
+
+    public:
+        explicit Attach(Scope* parent);
+        ~Attach();
+    };
+
+    // Innermost active scope of the calling thread, null if there is none
+    static Scope* current_scope();
+
+    // Turns profiling on and probes which hardware counters the kernel allows
+    static void enable();
+    static bool enabled();
+
+    // Whether hardware counters could be opened, false means timers only
+    static bool counters_available();
+
+    // Per-operation table: calls, pixels, time, IPC and misses per pixel
+    static void report(std::ostream& out);
+};
+
+#endif // PROFILER_H
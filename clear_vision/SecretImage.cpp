@@ -1,4 +1,176 @@
 #include "SecretImage.h"
+#include "Compression.h"
+#include "GrayscaleImageView.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char COMPRESSED_MAGIC[8] = {'C', 'V', 'S', 'E', 'C', 'R', 'E', 'T'};
+const int32_t COMPRESSED_VERSION = 1;
+
+// Index entry of one compressed chunk: which array it belongs to, the values it holds and
+// where its bytes are, relative to the end of the index.
+struct ChunkEntry {
+    int32_t array; // 0 upper, 1 lower
+    int32_t count;
+    int64_t first;
+    uint64_t offset;
+    uint32_t size;
+};
+
+// Everything in front of the chunk data
+struct CompressedHeader {
+    int32_t width, height;
+    std::vector<ChunkEntry> chunks;
+    std::streamoff data_start;
+};
+
+template <typename T>
+void write_value(std::ofstream& file, T value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+void read_value(std::ifstream& file, T& value) {
+    file.read(reinterpret_cast<char*>(&value), sizeof(value));
+}
+
+// True if the file starts with the compressed format's magic, the stream is rewound otherwise
+bool is_compressed(std::ifstream& file) {
+    char magic[8] = {0};
+    file.read(magic, 8);
+    if (file.gcount() == 8 && std::memcmp(magic, COMPRESSED_MAGIC, 8) == 0) {
+        return true;
+    }
+    file.clear();
+    file.seekg(0);
+    return false;
+}
+
+// Reads the header and chunk index that follow the magic
+CompressedHeader read_header(std::ifstream& file) {
+    CompressedHeader header;
+    int32_t version = 0, chunk_count = 0;
+    read_value(file, version);
+    read_value(file, header.width);
+    read_value(file, header.height);
+    read_value(file, chunk_count);
+    if (!file || version != COMPRESSED_VERSION || header.width < 0 || header.height < 0 || chunk_count < 0) {
+        throw std::runtime_error("Invalid compressed secret image header.");
+    }
+    header.chunks.resize(chunk_count);
+    for (ChunkEntry& chunk : header.chunks) {
+        read_value(file, chunk.array);
+        read_value(file, chunk.count);
+        read_value(file, chunk.first);
+        read_value(file, chunk.offset);
+        read_value(file, chunk.size);
+    }
+    if (!file) {
+        throw std::runtime_error("Compressed secret image index is truncated.");
+    }
+
+    // Every value of both arrays must come from exactly one chunk, otherwise pixels would stay uninitialized
+    long long sizes[2] = {(long long)header.height * (header.height + 1) / 2, (long long)header.height * (header.height - 1) / 2};
+    for (int array = 0; array < 2; array++) {
+        std::vector<std::pair<long long, long long> > ranges;
+        for (const ChunkEntry& chunk : header.chunks) {
+            if (chunk.array != 0 && chunk.array != 1) {
+                throw std::runtime_error("Compressed secret image chunk names an unknown array.");
+            }
+            if (chunk.array == array) ranges.push_back(std::make_pair((long long)chunk.first, (long long)chunk.first + chunk.count));
+        }
+        std::sort(ranges.begin(), ranges.end());
+        long long covered = 0;
+        for (const std::pair<long long, long long>& range : ranges) {
+            if (range.first != covered || range.second <= range.first) {
+                throw std::runtime_error("Compressed secret image chunks don't cover the image exactly once.");
+            }
+            covered = range.second;
+        }
+        if (covered != sizes[array]) {
+            throw std::runtime_error("Compressed secret image chunks don't cover the image exactly once.");
+        }
+    }
+    header.data_start = file.tellg();
+    return header;
+}
+
+// Runs fn(index) for every index, spread over the hardware threads. An exception thrown by fn
+// would terminate the program on a worker thread, so it is kept and rethrown once all threads joined.
+void parallel_chunks(int count, const std::function<void(int)>& fn) {
+    int threads = std::max(1, std::min(count, (int)std::thread::hardware_concurrency()));
+    std::atomic<int> next(0);
+    std::vector<std::exception_ptr> failures(count);
+    auto worker = [&]() {
+        int index;
+        while ((index = next++) < count) {
+            try {
+                fn(index);
+            } catch (...) {
+                failures[index] = std::current_exception();
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; t++) workers.push_back(std::thread(worker));
+    worker();
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+    for (const std::exception_ptr& failure : failures) {
+        if (failure) std::rethrow_exception(failure);
+    }
+}
+
+// Reads the selected chunks one after another, then decompresses them in parallel into the arrays.
+// upper and lower hold the values from index upper_origin and lower_origin of their array on.
+void decode_chunks(std::ifstream& file, const CompressedHeader& header, const std::vector<int>& selected,
+                   int* upper, long long upper_origin, int* lower, long long lower_origin) {
+    long long size_of_upper = (long long)header.height * (header.height + 1) / 2;
+    long long size_of_lower = (long long)header.height * (header.height - 1) / 2;
+    std::vector<std::vector<unsigned char> > buffers(selected.size());
+    for (size_t k = 0; k < selected.size(); k++) {
+        const ChunkEntry& chunk = header.chunks[selected[k]];
+        long long limit = (chunk.array == 0) ? size_of_upper : size_of_lower;
+        if (chunk.count < 0 || chunk.first < 0 || chunk.first + chunk.count > limit) {
+            throw std::runtime_error("Compressed secret image chunk lies outside its array.");
+        }
+        buffers[k].resize(chunk.size);
+        file.seekg(header.data_start + (std::streamoff)chunk.offset);
+        file.read(reinterpret_cast<char*>(buffers[k].data()), chunk.size);
+        if (!file) {
+            throw std::runtime_error("Compressed secret image data is truncated.");
+        }
+    }
+    parallel_chunks((int)selected.size(), [&](int k) {
+        const ChunkEntry& chunk = header.chunks[selected[k]];
+        int* target = (chunk.array == 0) ? upper + (chunk.first - upper_origin) : lower + (chunk.first - lower_origin);
+        Compression::decompress_chunk(buffers[k].data(), buffers[k].size(), target, chunk.count);
+    });
+}
+
+// Index of the first upper and lower triangular value of a row, following the split in the constructor
+long long upper_start(int row, int width) {
+    long long start = 0;
+    for (int r = 0; r < row; r++) start += std::max(0, width - r);
+    return start;
+}
+
+long long lower_start(int row, int width) {
+    long long start = 0;
+    for (int r = 0; r < row; r++) start += std::min(r, width);
+    return start;
+}
+
+} // namespace
 
 // Constructor: split image into upper and lower triangular arrays
 SecretImage::SecretImage(const GrayscaleImage& image) {
@@ -134,13 +306,93 @@ void SecretImage::save_to_file(const std::string& filename) {
     my_file.close();
 }
 
+// Save the triangular arrays as independently compressed chunks behind a chunk index
+void SecretImage::save_compressed(const std::string& filename, int chunkSize) const {
+    if (chunkSize < 1) {
+        throw std::invalid_argument("Chunk size must be positive.");
+    }
+    long long size_of_upper = (long long)height * (height + 1) / 2;
+    long long size_of_lower = (long long)height * (height - 1) / 2;
+
+    // 1. Cut both arrays into chunks.
+    std::vector<ChunkEntry> chunks;
+    for (int array = 0; array < 2; array++) {
+        long long size = (array == 0) ? size_of_upper : size_of_lower;
+        for (long long first = 0; first < size; first += chunkSize) {
+            ChunkEntry chunk;
+            chunk.array = array;
+            chunk.first = first;
+            chunk.count = (int32_t)std::min<long long>(chunkSize, size - first);
+            chunk.offset = 0;
+            chunk.size = 0;
+            chunks.push_back(chunk);
+        }
+    }
+
+    // 2. Compress the chunks in parallel, then lay them out in order.
+    std::vector<std::vector<unsigned char> > compressed(chunks.size());
+    parallel_chunks((int)chunks.size(), [&](int k) {
+        const int* source = ((chunks[k].array == 0) ? upper_triangular : lower_triangular) + chunks[k].first;
+        compressed[k] = Compression::compress_chunk(source, chunks[k].count);
+    });
+    uint64_t offset = 0;
+    for (size_t k = 0; k < chunks.size(); k++) {
+        chunks[k].offset = offset;
+        chunks[k].size = (uint32_t)compressed[k].size();
+        offset += compressed[k].size();
+    }
+
+    // 3. Write the magic, the header, the chunk index and the chunk data.
+    std::ofstream my_file(filename, std::ios::binary);
+    if (my_file.is_open() == false) {
+        throw std::runtime_error("Can't open the file for writing.");
+    }
+    my_file.write(COMPRESSED_MAGIC, 8);
+    write_value(my_file, COMPRESSED_VERSION);
+    write_value(my_file, (int32_t)width);
+    write_value(my_file, (int32_t)height);
+    write_value(my_file, (int32_t)chunks.size());
+    for (const ChunkEntry& chunk : chunks) {
+        write_value(my_file, chunk.array);
+        write_value(my_file, chunk.count);
+        write_value(my_file, chunk.first);
+        write_value(my_file, chunk.offset);
+        write_value(my_file, chunk.size);
+    }
+    for (const std::vector<unsigned char>& data : compressed) {
+        my_file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+    if (!my_file) {
+        throw std::runtime_error("Failed to write the compressed secret image.");
+    }
+}
+
 // Static function to load a SecretImage from a file
 SecretImage SecretImage::load_from_file(const std::string& filename) {
     // 1. Open the file and read width and height from the first line, separated by a space.
-    std::ifstream my_file(filename);
+    std::ifstream my_file(filename, std::ios::binary);
     if (my_file.is_open() == false) {
         throw std::runtime_error("Can't open the file for reading.");
     }
+
+    // Compressed files carry a magic in place of the text header, every chunk is decoded
+    if (is_compressed(my_file)) {
+        CompressedHeader header = read_header(my_file);
+        long long size_of_upper = (long long)header.height * (header.height + 1) / 2;
+        long long size_of_lower = (long long)header.height * (header.height - 1) / 2;
+        int* upper = new int[size_of_upper];
+        int* lower = new int[size_of_lower];
+        std::vector<int> selected(header.chunks.size());
+        for (size_t k = 0; k < selected.size(); k++) selected[k] = (int)k;
+        try {
+            decode_chunks(my_file, header, selected, upper, 0, lower, 0);
+        } catch (...) {
+            delete[] upper;
+            delete[] lower;
+            throw;
+        }
+        return SecretImage(header.width, header.height, upper, lower);
+    }
     int w,h;
     std::string line;
     std::getline(my_file, line);
@@ -172,8 +424,69 @@ SecretImage SecretImage::load_from_file(const std::string& filename) {
     // 6. Close the file and return a SecretImage object initialized with the
     //    width, height, and triangular arrays.
     my_file.close();
-    SecretImage secret_image(w, h, upper, lower);
-    return secret_image;
+    // Returned as a temporary: SecretImage owns raw arrays and has no copy constructor,
+    // so the object must be constructed in place for both file formats.
+    return SecretImage(w, h, upper, lower);
+}
+
+// Decode the rows of a region, touching only the chunks those rows are stored in
+GrayscaleImage SecretImage::load_region(const std::string& filename, int x, int y, int w, int h) {
+    std::ifstream my_file(filename, std::ios::binary);
+    if (my_file.is_open() == false) {
+        throw std::runtime_error("Can't open the file for reading.");
+    }
+    if (is_compressed(my_file) == false) {
+        my_file.close();
+        GrayscaleImage image = load_from_file(filename).reconstruct();
+        return GrayscaleImageView(image, x, y, w, h).to_image();
+    }
+
+    CompressedHeader header = read_header(my_file);
+    int width = header.width, height = header.height;
+    if (w < 1 || h < 1) {
+        throw std::invalid_argument("Region of interest must not be empty.");
+    }
+    if (x < 0 || y < 0 || x + w > width || y + h > height) {
+        throw std::out_of_range("Region of interest lies outside the image.");
+    }
+
+    // 1. The region's rows occupy one contiguous range of each array.
+    long long upper_first = upper_start(y, width), upper_last = upper_start(y + h, width);
+    long long lower_first = lower_start(y, width), lower_last = lower_start(y + h, width);
+    std::vector<int> selected;
+    for (size_t k = 0; k < header.chunks.size(); k++) {
+        const ChunkEntry& chunk = header.chunks[k];
+        long long first = (chunk.array == 0) ? upper_first : lower_first;
+        long long last = (chunk.array == 0) ? upper_last : lower_last;
+        if (chunk.first < last && chunk.first + chunk.count > first) {
+            selected.push_back((int)k);
+        }
+    }
+
+    // 2. Decode just those chunks, into buffers spanning only the selected chunks.
+    long long origin[2] = {-1, -1}, end[2] = {0, 0};
+    for (int k : selected) {
+        const ChunkEntry& chunk = header.chunks[k];
+        int array = (chunk.array == 0) ? 0 : 1;
+        if (origin[array] < 0 || chunk.first < origin[array]) origin[array] = chunk.first;
+        end[array] = std::max<long long>(end[array], chunk.first + chunk.count);
+    }
+    for (int array = 0; array < 2; array++) origin[array] = std::max(0LL, origin[array]);
+    std::vector<int> upper(std::max(0LL, end[0] - origin[0])), lower(std::max(0LL, end[1] - origin[1]));
+    decode_chunks(my_file, header, selected, upper.data(), origin[0], lower.data(), origin[1]);
+
+    // 3. Pick the region's pixels out of the triangular arrays.
+    GrayscaleImage region(w, h);
+    long long upper_row = upper_first, lower_row = lower_first;
+    for (int i = y; i < y + h; i++) {
+        for (int j = x; j < x + w; j++) {
+            int value = (j >= i) ? upper[upper_row + (j - i) - origin[0]] : lower[lower_row + j - origin[1]];
+            region.set_pixel(i - y, j - x, value);
+        }
+        upper_row += std::max(0, width - i);
+        lower_row += std::min(i, width);
+    }
+    return region;
 }
 
 // Returns a pointer to the upper triangular part of the secret image.
@@ -37,9 +37,18 @@ public:
     // Saves a secret image into the given file
     void save_to_file(const std::string &filename);
 
-    // Reads a secret image from the given file
+    // Saves a secret image into the given file as independently compressed chunks of at most
+    // chunkSize values each, with a chunk index in front so chunks can be read selectively.
+    void save_compressed(const std::string &filename, int chunkSize = 65536) const;
+
+    // Reads a secret image from the given file, in the text or the compressed format.
+    // Compressed chunks are decoded in parallel.
     static SecretImage load_from_file(const std::string &filename);
 
+    // Reads the pixels of a region (x, y, w, h) of a saved secret image. Only the chunks
+    // holding the region's rows are decoded; text files are read completely.
+    static GrayscaleImage load_region(const std::string &filename, int x, int y, int w, int h);
+
     // Getters and setters for private instance variables
     int *get_upper_triangular() const;
     int *get_lower_triangular() const;
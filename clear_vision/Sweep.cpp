@@ -0,0 +1,211 @@
+#include "Sweep.h"
+#include "GrayscaleImage.h"
+#include "Filter.h"
+#include "Convolution.h"
+#include "Profiler.h"
+#include "FileNames.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+// One file produced by the sweep
+struct SweepOutput {
+    std::string filename;
+    std::function<GrayscaleImage()> produce;
+};
+
+// Runs job(index) for every index in [0, count) on up to `workers` threads claiming indices in order.
+// Workers run side by side, each one only gets its share of the convolution threads.
+void run_parallel(size_t count, int workers, const std::function<void(size_t)>& job) {
+    int worker_count = (int)std::max<size_t>(1, std::min<size_t>(std::max(1, workers), count));
+    std::atomic<size_t> next_index(0);
+    auto worker = [&]() {
+        Convolution::ThreadBudget budget(Convolution::shared_thread_budget(worker_count));
+        size_t index;
+        while ((index = next_index++) < count) {
+            job(index);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 0; i < worker_count; i++) threads.push_back(std::thread(worker));
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+// Summed area table with one extra leading row and column of zeros, so any window sum
+// takes four lookups. Sums of integer pixels are exact.
+class IntegralImage {
+private:
+    std::vector<long long> sums;
+    int width, height;
+
+public:
+    explicit IntegralImage(const GrayscaleImage& image) : width(image.get_width()), height(image.get_height()) {
+        Profiler::Scope scope("integral", (long long)width * height);
+        sums.assign((size_t)(width + 1) * (height + 1), 0);
+        for (int i = 0; i < height; i++) {
+            const int* row = image.get_data()[i];
+            long long running = 0;
+            for (int j = 0; j < width; j++) {
+                running += row[j];
+                sums[(size_t)(i + 1) * (width + 1) + j + 1] = sums[(size_t)i * (width + 1) + j + 1] + running;
+            }
+        }
+    }
+
+    // Mean filter of the given size: pixels outside the image count as zero and the window sum
+    // is divided by kernelSize * kernelSize, exactly like Filter::apply_mean_filter.
+    GrayscaleImage mean(int kernelSize) const {
+        if (kernelSize < 1) {
+            throw std::invalid_argument("Kernel size must be positive.");
+        }
+        Profiler::Scope scope("integral_mean", (long long)width * height);
+        int center = kernelSize / 2;
+        double divisor = (double)kernelSize * kernelSize;
+        GrayscaleImage result(width, height);
+        for (int i = 0; i < height; i++) {
+            int top = std::max(0, i - center), bottom = std::min(height, i - center + kernelSize);
+            const long long* upper = &sums[(size_t)top * (width + 1)];
+            const long long* lower = &sums[(size_t)bottom * (width + 1)];
+            int* target = result.get_data()[i];
+            for (int j = 0; j < width; j++) {
+                int left = std::max(0, j - center), right = std::min(width, j - center + kernelSize);
+                long long total = lower[right] - lower[left] - upper[right] + upper[left];
+                target[j] = std::min(255, std::max(0, (int)(total / divisor)));
+            }
+        }
+        return result;
+    }
+};
+
+} // namespace
+
+// Number of parameter lists of each sweep operation
+int Sweep::argument_count(const std::string& operation) {
+    if (operation == "mean") return 1;
+    if (operation == "gauss") return 2;
+    if (operation == "unsharp") return 2;
+    return -1;
+}
+
+// Split "a,b,c" into its items, empty items are rejected
+std::vector<std::string> Sweep::split_list(const std::string& list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (item.empty()) {
+            throw std::invalid_argument("Empty value in parameter list " + list);
+        }
+        items.push_back(item);
+    }
+    if (items.empty()) {
+        throw std::invalid_argument("Empty parameter list.");
+    }
+    return items;
+}
+
+// Decode once, build the shared intermediates, then finish and encode the outputs in parallel
+void Sweep::run(const std::string& operation, const std::string& input,
+                const std::vector<std::string>& lists, int workers) {
+    if (argument_count(operation) < 0 || (int)lists.size() != argument_count(operation)) {
+        throw std::invalid_argument("Invalid arguments for sweep operation: " + operation);
+    }
+    workers = std::max(1, workers);
+    auto start = std::chrono::steady_clock::now();
+
+    // 1. Decode the image once.
+    std::shared_ptr<GrayscaleImage> image = std::make_shared<GrayscaleImage>(input.c_str());
+    std::string stem = remove_extension(input);
+
+    // 2. List the shared intermediates and the outputs that finish from them.
+    std::vector<std::function<void()> > intermediates;
+    std::vector<SweepOutput> outputs;
+    if (operation == "mean") {
+        std::shared_ptr<IntegralImage> integral = std::make_shared<IntegralImage>(*image);
+        for (const std::string& item : split_list(lists[0])) {
+            int kernel_size = std::stoi(item);
+            SweepOutput output;
+            output.filename = "mean_filtered_" + stem + "_" + std::to_string(kernel_size) + ".png";
+            output.produce = [integral, kernel_size]() { return integral->mean(kernel_size); };
+            outputs.push_back(output);
+        }
+    } else if (operation == "gauss") {
+        // Every (size, sigma) pair needs its own kernel, only the decoded image is shared
+        for (const std::string& size_item : split_list(lists[0])) {
+            for (const std::string& sigma_item : split_list(lists[1])) {
+                int kernel_size = std::stoi(size_item);
+                double sigma = std::stof(sigma_item);
+                SweepOutput output;
+                output.filename = "gaussian_filtered_" + stem + "_" + std::to_string(kernel_size) + "_" + std::to_string(sigma) + ".png";
+                output.produce = [image, kernel_size, sigma]() {
+                    GrayscaleImage result = *image;
+                    Filter::apply_gaussian_smoothing(result, kernel_size, sigma);
+                    return result;
+                };
+                outputs.push_back(output);
+            }
+        }
+    } else {
+        // One blur per kernel size, with the sigma the unsharp mask always uses
+        std::vector<std::string> amounts = split_list(lists[1]);
+        for (const std::string& size_item : split_list(lists[0])) {
+            int kernel_size = std::stoi(size_item);
+            std::shared_ptr<GrayscaleImage> blurred = std::make_shared<GrayscaleImage>(*image);
+            intermediates.push_back([blurred, kernel_size]() { Filter::apply_gaussian_smoothing(*blurred, kernel_size, 1); });
+            for (const std::string& amount_item : amounts) {
+                double amount = std::stof(amount_item);
+                SweepOutput output;
+                output.filename = "unsharp_filtered_" + stem + "_" + std::to_string(kernel_size) + "_" + std::to_string(amount) + ".png";
+                output.produce = [image, blurred, amount]() { return Filter::sharpen(*image, *blurred, amount); };
+                outputs.push_back(output);
+            }
+        }
+    }
+
+    // 3. Build the intermediates in parallel. Every output depends on one, so a failure here fails the sweep.
+    std::vector<std::exception_ptr> failures(intermediates.size());
+    run_parallel(intermediates.size(), workers, [&](size_t index) {
+        try {
+            intermediates[index]();
+        } catch (...) {
+            failures[index] = std::current_exception();
+        }
+    });
+    for (const std::exception_ptr& failure : failures) {
+        if (failure) std::rethrow_exception(failure);
+    }
+
+    // 4. Workers claim outputs in order, finish them and encode them.
+    std::mutex error_mutex;
+    std::vector<std::string> errors;
+    run_parallel(outputs.size(), workers, [&](size_t index) {
+        try {
+            outputs[index].produce().save(outputs[index].filename.c_str());
+        } catch (const std::exception& e) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            errors.push_back(outputs[index].filename + ": " + e.what());
+        }
+    });
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Wrote " << outputs.size() - errors.size() << " of " << outputs.size() << " outputs in " << seconds << " s." << std::endl;
+
+    if (!errors.empty()) {
+        for (const std::string& error : errors) {
+            std::cerr << "Error: " << error << std::endl;
+        }
+        throw std::runtime_error("Sweep finished with " + std::to_string(errors.size()) + " failed outputs.");
+    }
+}
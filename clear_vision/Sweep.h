@@ -0,0 +1,25 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <string>
+#include <vector>
+
+// Runs one filter over a list of parameter values on a single image. The image is decoded
+// once and the work the outputs have in common is done once: one integral image serves every
+// mean size and one blur per kernel size serves every unsharp amount. The blurs are computed
+// in parallel, then the outputs are finished and encoded in parallel, under the file names of
+// the single image operations.
+class Sweep {
+public:
+    // Number of parameter lists each sweep operation takes after the image, or -1 if unsupported
+    static int argument_count(const std::string& operation);
+
+    // Splits a comma separated list such as "3,11,19"
+    static std::vector<std::string> split_list(const std::string& list);
+
+    // mean <sizes>, gauss <sizes> <sigmas> (every combination) or unsharp <sizes> <amounts>
+    static void run(const std::string& operation, const std::string& input,
+                    const std::vector<std::string>& lists, int workers);
+};
+
+#endif // SWEEP_H
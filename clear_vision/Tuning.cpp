@@ -0,0 +1,211 @@
+#include "Tuning.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// One measured grid point of the profile
+struct TuningEntry {
+    Convolution::KernelKind kind;
+    int pixels;
+    int kernel_size;
+    int budget; // the plan is the fastest measured with at most this many threads
+    Convolution::Plan plan;
+};
+
+const char* kind_name(Convolution::KernelKind kind) {
+    switch (kind) {
+        case Convolution::BOX_KERNEL: return "box";
+        case Convolution::SEPARABLE_KERNEL: return "separable";
+        default: return "dense";
+    }
+}
+
+bool kind_from_name(const std::string& name, Convolution::KernelKind& kind) {
+    if (name == "box") kind = Convolution::BOX_KERNEL;
+    else if (name == "separable") kind = Convolution::SEPARABLE_KERNEL;
+    else if (name == "dense") kind = Convolution::DENSE_KERNEL;
+    else return false;
+    return true;
+}
+
+// Reads a profile, skipping comments and malformed lines
+std::vector<TuningEntry> read_profile(const std::string& filename) {
+    std::vector<TuningEntry> entries;
+    std::ifstream file(filename);
+    std::string line;
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::string kind, strategy;
+        TuningEntry entry;
+        if (fields >> kind >> entry.pixels >> entry.kernel_size >> strategy >> entry.plan.fft_size >> entry.plan.threads
+            && kind_from_name(kind, entry.kind)) {
+            // Profiles without the budget column only vouch for the plan's own thread count
+            if (!(fields >> entry.budget)) entry.budget = entry.plan.threads;
+            entry.plan.strategy = Convolution::strategy_from_name(strategy);
+            if (entry.plan.strategy != Convolution::AUTO && entry.pixels > 0 && entry.kernel_size > 0
+                && entry.plan.threads >= 1 && entry.plan.threads <= entry.budget) {
+                entries.push_back(entry);
+            }
+        }
+    }
+    return entries;
+}
+
+// The profile is read once per process
+const std::vector<TuningEntry>& loaded_profile() {
+    static const std::vector<TuningEntry> entries = read_profile(Tuning::profile_path());
+    return entries;
+}
+
+// Fastest of a few runs of one plan, in seconds
+double time_plan(const GrayscaleImage& input, const Kernel& kernel, const Convolution::Plan& plan, int runs) {
+    double best = 0;
+    for (int run = 0; run < runs; run++) {
+        GrayscaleImage image = input;
+        auto start = std::chrono::steady_clock::now();
+        Convolution::apply(image, kernel, plan);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (run == 0 || seconds < best) best = seconds;
+    }
+    return best;
+}
+
+// Representative kernel of each kind
+Kernel tuning_kernel(Convolution::KernelKind kind, int size) {
+    if (kind == Convolution::BOX_KERNEL) {
+        return Convolution::box_kernel(size);
+    }
+    if (kind == Convolution::SEPARABLE_KERNEL) {
+        return Convolution::gaussian_kernel(size, std::max(1.0, size / 6.0));
+    }
+    Kernel kernel(size, size);
+    srand(size);
+    double total = 0;
+    for (double& weight : kernel.weights) {
+        weight = rand() / (double)RAND_MAX;
+        total += weight;
+    }
+    for (double& weight : kernel.weights) weight /= total;
+    return kernel;
+}
+
+} // namespace
+
+// Location of the machine-local profile
+std::string Tuning::profile_path() {
+    const char* path = std::getenv("CLEARVISION_TUNING");
+    if (path != nullptr && path[0] != '\0') {
+        return path;
+    }
+    const char* home = std::getenv("HOME");
+    return std::string(home != nullptr ? home : ".") + "/.clearvision_tuning";
+}
+
+// Benchmark the grid and write the fastest plan of each point for every thread budget
+void Tuning::tune(const std::string& filename) {
+    const int sides[] = {256, 512, 1024};
+    const int kernel_sizes[] = {3, 7, 15, 25, 41, 61};
+    const Convolution::KernelKind kinds[] = {Convolution::BOX_KERNEL, Convolution::SEPARABLE_KERNEL, Convolution::DENSE_KERNEL};
+
+    // 1. Thread counts to try: powers of two up to the hardware threads, plus the hardware threads.
+    int hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> thread_counts;
+    for (int threads = 1; threads < hardware_threads; threads *= 2) thread_counts.push_back(threads);
+    thread_counts.push_back(hardware_threads);
+
+    std::ostringstream profile;
+    profile << "# clearvision tuning profile, " << hardware_threads << " hardware threads\n";
+    profile << "# kind pixels kernel_size strategy fft_size threads budget\n";
+
+    for (int side : sides) {
+        GrayscaleImage input(side, side);
+        srand(side);
+        for (int i = 0; i < side; i++) {
+            for (int j = 0; j < side; j++) input.set_pixel(i, j, rand() % 256);
+        }
+
+        for (Convolution::KernelKind kind : kinds) {
+            for (int size : kernel_sizes) {
+                Kernel kernel = tuning_kernel(kind, size);
+
+                // 2. Candidate plans: every applicable strategy, FFT block sizes around the model's choice.
+                std::vector<Convolution::Plan> candidates;
+                Convolution::Strategy strategies[] = {Convolution::DIRECT, Convolution::SEPARABLE, Convolution::BOX, Convolution::FFT};
+                int model_size = 1;
+                while (model_size <= size) model_size <<= 1;
+                for (Convolution::Strategy strategy : strategies) {
+                    if (!Convolution::supports(kernel, strategy)) continue;
+                    // Direct convolution with large kernels is never competitive, skip the long runs
+                    if (strategy == Convolution::DIRECT && size > 25) continue;
+                    std::vector<int> fft_sizes(1, 0);
+                    if (strategy == Convolution::FFT) {
+                        fft_sizes.assign(1, model_size * 2);
+                        fft_sizes.push_back(model_size * 4);
+                        if (model_size * 8 <= 2048) fft_sizes.push_back(model_size * 8);
+                    }
+                    for (int fft_size : fft_sizes) {
+                        for (int threads : thread_counts) {
+                            candidates.push_back(Convolution::Plan(strategy, fft_size, threads));
+                        }
+                    }
+                }
+
+                // 3. Measure them once, then keep the fastest within each thread budget. Callers get the
+                //    entry of their own budget, so a plan never runs with a thread count that was not measured.
+                std::vector<double> seconds(candidates.size());
+                for (size_t c = 0; c < candidates.size(); c++) {
+                    seconds[c] = time_plan(input, kernel, candidates[c], 2);
+                }
+                for (int budget : thread_counts) {
+                    int best = -1;
+                    for (size_t c = 0; c < candidates.size(); c++) {
+                        if (candidates[c].threads <= budget && (best < 0 || seconds[c] < seconds[best])) best = (int)c;
+                    }
+                    if (best < 0) continue;
+                    const Convolution::Plan& plan = candidates[best];
+                    profile << kind_name(kind) << " " << side * side << " " << size << " "
+                            << Convolution::strategy_name(plan.strategy) << " " << plan.fft_size << " " << plan.threads
+                            << " " << budget << "\n";
+                    std::cout << kind_name(kind) << " " << side << "x" << side << " kernel " << size << ", budget " << budget
+                              << ": " << Convolution::strategy_name(plan.strategy) << ", fft size " << plan.fft_size
+                              << ", " << plan.threads << " threads, " << seconds[best] * 1000.0 << " ms" << std::endl;
+                }
+            }
+        }
+    }
+
+    std::ofstream file(filename);
+    if (file.is_open() == false) {
+        throw std::runtime_error("Can't open the tuning profile for writing: " + filename);
+    }
+    file << profile.str();
+}
+
+// Nearest grid point of the same kind, distance measured in octaves of image area and kernel size.
+// Among the budgets measured there, the largest one that fits the caller's.
+bool Tuning::lookup(Convolution::KernelKind kind, int pixels, int kernelSize, int maxThreads, Convolution::Plan& plan) {
+    const std::vector<TuningEntry>& entries = loaded_profile();
+    double best_distance = -1;
+    int best_budget = 0;
+    for (const TuningEntry& entry : entries) {
+        if (entry.kind != kind || entry.budget > maxThreads) continue;
+        double distance = std::fabs(std::log2((double)std::max(1, pixels) / entry.pixels))
+                        + 2.0 * std::fabs(std::log2((double)std::max(1, kernelSize) / entry.kernel_size));
+        if (best_distance < 0 || distance < best_distance || (distance == best_distance && entry.budget > best_budget)) {
+            best_distance = distance;
+            best_budget = entry.budget;
+            plan = entry.plan;
+        }
+    }
+    return best_distance >= 0;
+}
@@ -0,0 +1,24 @@
+#ifndef TUNING_H
+#define TUNING_H
+
+#include "Convolution.h"
+#include <string>
+
+// Machine-local tuning profile for the convolution engine. "clearvision tune" benchmarks every
+// strategy, FFT block size and thread count over a grid of image and kernel sizes and stores the
+// fastest plan per grid point and thread budget; Convolution::choose_plan consults it at runtime
+// with the caller's budget.
+class Tuning {
+public:
+    // $CLEARVISION_TUNING if set, otherwise ~/.clearvision_tuning
+    static std::string profile_path();
+
+    // Benchmarks the candidates on this machine and writes the profile to the given file
+    static void tune(const std::string& filename);
+
+    // Plan stored for the nearest grid point of the same kernel kind, measured with at most
+    // maxThreads threads. Returns false when the profile has no such entry.
+    static bool lookup(Convolution::KernelKind kind, int pixels, int kernelSize, int maxThreads, Convolution::Plan& plan);
+};
+
+#endif // TUNING_H
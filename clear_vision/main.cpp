@@ -1,78 +1,207 @@
 #include "GrayscaleImage.h"
+#include "GrayscaleImageView.h"
 #include "SecretImage.h"
 #include "Filter.h"
 #include "Crypto.h"
+#include "Batch.h"
+#include "Sweep.h"
+#include "Convolution.h"
+#include "Tuning.h"
+#include "Profiler.h"
+#include "FileNames.h"
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
-// Utility function to remove the file extension from a given filename
-std::string remove_extension(const std::string& filename) {
-    size_t last_dot = filename.find_last_of(".");
-    return (last_dot != std::string::npos && last_dot > 0) ? filename.substr(0, last_dot) : filename;
+// Region given with --roi x,y,w,h; operations work on the whole image when it is not set
+struct RegionOfInterest {
+    bool set;
+    int x, y, width, height;
+
+    RegionOfInterest() : set(false), x(0), y(0), width(0), height(0) {}
+};
+
+// Parses "x,y,w,h" into a region of interest
+RegionOfInterest parse_roi(const std::string& text) {
+    RegionOfInterest roi;
+    std::stringstream stream(text);
+    char comma1 = 0, comma2 = 0, comma3 = 0;
+    stream >> roi.x >> comma1 >> roi.y >> comma2 >> roi.width >> comma3 >> roi.height;
+    if (!stream || comma1 != ',' || comma2 != ',' || comma3 != ',' || !stream.eof()) {
+        throw std::invalid_argument("Region of interest must be given as x,y,w,h");
+    }
+    if (roi.width < 1 || roi.height < 1) {
+        throw std::invalid_argument("Region of interest must not be empty.");
+    }
+    roi.set = true;
+    return roi;
+}
+
+// View of the region of interest, or of the whole image when no region was given
+GrayscaleImageView roi_view(GrayscaleImage& img, const RegionOfInterest& roi) {
+    if (!roi.set) return GrayscaleImageView(img);
+    return GrayscaleImageView(img, roi.x, roi.y, roi.width, roi.height);
 }
 
 // Applies a mean filter to the input image and saves the result
-void apply_mean_filter(const char* input_image, int kernel_size) {
+void apply_mean_filter(const char* input_image, int kernel_size, const RegionOfInterest& roi) {
     GrayscaleImage img(input_image);
-    Filter::apply_mean_filter(img, kernel_size);
+    Filter::apply_mean_filter(roi_view(img, roi), kernel_size);
     std::string output_filename = "mean_filtered_" + remove_extension(input_image) + "_" + std::to_string(kernel_size) + ".png";
     img.save_to_file(output_filename.c_str());
 }
 
 // Applies Gaussian smoothing to the input image and saves the result
-void apply_gaussian_smoothing(const char* input_image, int kernel_size, double sigma) {
+void apply_gaussian_smoothing(const char* input_image, int kernel_size, double sigma, const RegionOfInterest& roi) {
     GrayscaleImage img(input_image);
-    Filter::apply_gaussian_smoothing(img, kernel_size, sigma);
+    Filter::apply_gaussian_smoothing(roi_view(img, roi), kernel_size, sigma);
     std::string output_filename = "gaussian_filtered_" + remove_extension(input_image) + "_" + std::to_string(kernel_size) + "_" + std::to_string(sigma) + ".png";
     img.save_to_file(output_filename.c_str());
 }
 
 // Applies an unsharp mask to the input image to enhance sharpness and saves the result
-void apply_unsharp_mask(const char* input_image, int kernel_size, double amount) {
+void apply_unsharp_mask(const char* input_image, int kernel_size, double amount, const RegionOfInterest& roi) {
     GrayscaleImage img(input_image);
-    Filter::apply_unsharp_mask(img, kernel_size, amount);
+    Filter::apply_unsharp_mask(roi_view(img, roi), kernel_size, amount);
     std::string output_filename = "unsharp_filtered_" + remove_extension(input_image) + "_" + std::to_string(kernel_size) + "_" + std::to_string(amount) + ".png";
     img.save_to_file(output_filename.c_str());
 }
 
+// Applies a morphological operation with a rectangular structuring element and saves the result
+void apply_morphology(const char* input_image, const std::string& operation, int element_width, int element_height) {
+    GrayscaleImage img(input_image);
+    if (operation == "erode") Filter::apply_erosion(img, element_width, element_height);
+    else if (operation == "dilate") Filter::apply_dilation(img, element_width, element_height);
+    else if (operation == "open") Filter::apply_opening(img, element_width, element_height);
+    else if (operation == "close") Filter::apply_closing(img, element_width, element_height);
+    else Filter::apply_morphological_gradient(img, element_width, element_height);
+    std::string output_filename = operation + "_filtered_" + remove_extension(input_image) + "_" + std::to_string(element_width) + "x" + std::to_string(element_height) + ".png";
+    img.save_to_file(output_filename.c_str());
+}
+
+// Applies an edge-preserving bilateral filter to the input image and saves the result
+void apply_bilateral_filter(const char* input_image, double spatial_sigma, double range_sigma) {
+    GrayscaleImage img(input_image);
+    Filter::apply_bilateral_filter(img, spatial_sigma, range_sigma);
+    std::string output_filename = "bilateral_filtered_" + remove_extension(input_image) + "_" + std::to_string(spatial_sigma) + "_" + std::to_string(range_sigma) + ".png";
+    img.save_to_file(output_filename.c_str());
+}
+
+// Convolves the input image with a kernel loaded from a file and saves the result
+void apply_convolution(const char* input_image, const char* kernel_file, const std::string& strategy_name, const RegionOfInterest& roi) {
+    Kernel kernel = Convolution::load_kernel(kernel_file);
+    GrayscaleImage img(input_image);
+    GrayscaleImageView view = roi_view(img, roi);
+    Convolution::Plan plan(Convolution::strategy_from_name(strategy_name));
+    if (plan.strategy == Convolution::AUTO) {
+        if (strategy_name != "auto") throw std::invalid_argument("Unknown convolution strategy " + strategy_name);
+        plan = Convolution::choose_plan(kernel, view.get_width(), view.get_height());
+    } else if (!Convolution::supports(kernel, plan.strategy)) {
+        throw std::invalid_argument("The kernel does not support the " + strategy_name + " strategy");
+    }
+    Convolution::apply(view, kernel, plan);
+    std::cout << "Strategy: " << Convolution::strategy_name(plan.strategy) << ", threads: " << plan.threads << std::endl;
+    std::string kernel_name = remove_extension(kernel_file);
+    kernel_name = kernel_name.substr(kernel_name.find_last_of('/') + 1);
+    std::string output_filename = "convolved_" + remove_extension(input_image) + "_" + kernel_name + ".png";
+    img.save_to_file(output_filename.c_str());
+}
+
+// Applies a median filter to the input image and saves the result
+void apply_median_filter(const char* input_image, int kernel_size, const RegionOfInterest& roi) {
+    GrayscaleImage img(input_image);
+    Filter::apply_median_filter(roi_view(img, roi), kernel_size);
+    std::string output_filename = "median_filtered_" + remove_extension(input_image) + "_" + std::to_string(kernel_size) + ".png";
+    img.save_to_file(output_filename.c_str());
+}
+
+// Applies a multi-scale filter, saves the result and optionally reports its error against the exact filter
+void apply_multiscale_filter(const char* input_image, const std::string& filter, int kernel_size, double sigma, int levels, bool report_error) {
+    GrayscaleImage img(input_image);
+    GrayscaleImage exact = img;
+    int level_used;
+    std::string output_filename;
+    if (filter == "gauss") {
+        level_used = Filter::apply_gaussian_smoothing_multiscale(img, kernel_size, sigma, levels);
+        output_filename = "gaussian_filtered_" + remove_extension(input_image) + "_" + std::to_string(kernel_size) + "_" + std::to_string(sigma) + "_pyr" + std::to_string(level_used) + ".png";
+    } else {
+        level_used = Filter::apply_mean_filter_multiscale(img, kernel_size, levels);
+        output_filename = "mean_filtered_" + remove_extension(input_image) + "_" + std::to_string(kernel_size) + "_pyr" + std::to_string(level_used) + ".png";
+    }
+    img.save_to_file(output_filename.c_str());
+    std::cout << "Pyramid level used: " << level_used << std::endl;
+
+    if (report_error) {
+        if (filter == "gauss") {
+            Filter::apply_gaussian_smoothing(exact, kernel_size, sigma);
+        } else {
+            Filter::apply_mean_filter(exact, kernel_size);
+        }
+        std::cout << "Max error: " << img.max_difference(exact) << ", RMS error: " << img.rms_difference(exact) << std::endl;
+    }
+}
+
 // Adds two images together and saves the resulting image
-void add_images(const char* img1, const char* img2) {
+void add_images(const char* img1, const char* img2, const RegionOfInterest& roi) {
     GrayscaleImage image1(img1), image2(img2);
-    GrayscaleImage result = image1 + image2; // burda operator overloading
+    GrayscaleImage result = image1;
+    if (roi.set) {
+        // Only the region is added, the rest of the first image is kept
+        roi_view(result, roi).assign(roi_view(image1, roi) + roi_view(image2, roi));
+    } else {
+        result = image1 + image2; // burda operator overloading
+    }
     std::string output_filename = "added_" + remove_extension(img1) + "_" + remove_extension(img2) + ".png";
     result.save_to_file(output_filename.c_str());
 }
 
 // Subtracts the second image from the first and saves the resulting image
-void subtract_images(const char* img1, const char* img2) {
+void subtract_images(const char* img1, const char* img2, const RegionOfInterest& roi) {
     GrayscaleImage image1(img1), image2(img2);
-    GrayscaleImage result = image1 - image2;
+    GrayscaleImage result = image1;
+    if (roi.set) {
+        roi_view(result, roi).assign(roi_view(image1, roi) - roi_view(image2, roi));
+    } else {
+        result = image1 - image2;
+    }
     std::string output_filename = "subtracted_" + remove_extension(img1) + "_" + remove_extension(img2) + ".png";
     result.save_to_file(output_filename.c_str());
 }
 
 // Compares two images and prints whether they are identical
-void compare_images(const char* img1, const char* img2) {
+void compare_images(const char* img1, const char* img2, const RegionOfInterest& roi) {
     GrayscaleImage image1(img1), image2(img2);
-    bool are_equal = (image1 == image2);
+    bool are_equal = roi.set ? (roi_view(image1, roi) == roi_view(image2, roi)) : (image1 == image2);
     std::cout << (are_equal ? "Images are equal." : "Images are not equal.") << std::endl;
 }
 
 // Converts a GrayscaleImage to a SecretImage and saves it in a disguised format
-void disguise_image(const char* input_image) {
+void disguise_image(const char* input_image, bool compress) {
     GrayscaleImage img(input_image);
     SecretImage secret_img(img);
     std::string output_filename = "secret_image_" + remove_extension(input_image) + ".dat";
-    secret_img.save_to_file(output_filename.c_str());
+    if (compress) {
+        secret_img.save_compressed(output_filename);
+    } else {
+        secret_img.save_to_file(output_filename.c_str());
+    }
 }
 
 // Reconstructs a GrayscaleImage from a previously saved SecretImage file
-void reveal_image(const char* input_file) {
+void reveal_image(const char* input_file, const RegionOfInterest& roi) {
+    std::string output_filename = "reconstructed_" + remove_extension(input_file) + ".png";
+    if (roi.set) {
+        // Only the chunks holding the region are decoded
+        SecretImage::load_region(input_file, roi.x, roi.y, roi.width, roi.height).save_to_file(output_filename.c_str());
+        return;
+    }
     SecretImage secret_img = SecretImage::load_from_file(input_file);
     GrayscaleImage reconstructed = secret_img.reconstruct();
-    std::string output_filename = "reconstructed_" + remove_extension(input_file) + ".png";
     reconstructed.save_to_file(output_filename.c_str());
 }
 
@@ -92,6 +221,68 @@ void decrypt_image(const char* input_image, int message_length) {
     std::cout << "Decrypted Message: " << message << std::endl;
 }
 
+// Runs an operation over many files through the batch pipeline.
+// argv holds: <operation> <op args...> <files, directories or @lists...> [--decoders N] [--workers N] [--encoders N] [--queue N]
+void batch_process(int argc, char** argv) {
+    std::string operation = argv[0];
+    int arg_count = Batch::argument_count(operation);
+    if (arg_count < 0) throw std::invalid_argument("Unsupported batch operation: " + operation);
+    int optional_count = Batch::optional_argument_count(operation);
+    // Optional arguments are numbers, so the first path ends them
+    auto is_number = [](const std::string& text) {
+        return !text.empty() && text.find_first_not_of("0123456789") == std::string::npos;
+    };
+
+    std::vector<std::string> args, paths;
+    Batch::Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 2, "--") == 0) {
+            if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + arg);
+            int value = std::stoi(argv[++i]);
+            if (arg == "--decoders") options.decode_workers = value;
+            else if (arg == "--workers") options.filter_workers = value;
+            else if (arg == "--encoders") options.encode_workers = value;
+            else if (arg == "--queue") options.queue_capacity = value;
+            else throw std::invalid_argument("Unknown batch option " + arg);
+        } else if ((int)args.size() < arg_count) {
+            args.push_back(arg);
+        } else if (paths.empty() && (int)args.size() < arg_count + optional_count && is_number(arg)) {
+            args.push_back(arg);
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if ((int)args.size() < arg_count || paths.empty()) {
+        throw std::invalid_argument("Usage: clearvision batch <operation> <op args> <files|dirs|@list>");
+    }
+    Batch::run(operation, args, Batch::collect_inputs(paths), options);
+}
+
+// Runs one filter over lists of parameters on a single image.
+// argv holds: <operation> <img> <comma separated lists...> [--workers N]
+void sweep_process(int argc, char** argv) {
+    std::string operation = argv[0];
+    int list_count = Sweep::argument_count(operation);
+    if (list_count < 0) throw std::invalid_argument("Unsupported sweep operation: " + operation);
+
+    std::vector<std::string> lists;
+    int workers = std::max(1, (int)std::thread::hardware_concurrency());
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--workers") {
+            if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + arg);
+            workers = std::stoi(argv[++i]);
+        } else {
+            lists.push_back(arg);
+        }
+    }
+    if ((int)lists.size() != list_count) {
+        throw std::invalid_argument("Usage: clearvision sweep mean <img> <sizes> | gauss <img> <sizes> <sigmas> | unsharp <img> <sizes> <amounts>");
+    }
+    Sweep::run(operation, argv[1], lists, workers);
+}
+
 int main(int argc, char** argv) {
     // Check if enough arguments are provided
     if (argc < 2) {
@@ -101,51 +292,117 @@ int main(int argc, char** argv) {
             "clearvision mean <img> <kernel_size> \n"
             "clearvision gauss <img> <kernel_size> <sigma> \n"
             "clearvision unsharp <img> <kernel_size> <amount> \n"
+            "clearvision gauss_pyr <img> <kernel_size> <sigma> <levels> [--error] \n"
+            "clearvision mean_pyr <img> <kernel_size> <levels> [--error] \n"
+            "clearvision median <img> <kernel_size> \n"
+            "clearvision bilateral <img> <spatial_sigma> <range_sigma> \n"
+            "clearvision erode|dilate|open|close|gradient <img> <width> [height] \n"
+            "clearvision conv <img> <kernel_file> [auto|direct|separable|box|fft] \n"
+            "clearvision tune [profile_file] \n"
             "clearvision add <img1> <img2> \n"
             "clearvision sub <img1> <img2> \n"
             "clearvision equals <img1> <img2> \n"
-            "clearvision disguise <img> <msg> \n"
-            "clearvision reveal <img> <msg> \n"
+            "clearvision disguise <img> [--compress] \n"
+            "clearvision reveal <dat> [--roi x,y,w,h] \n"
             "clearvision enc <img> <msg> \n"
-            "clearvision dec <img> <msg_len>"
+            "clearvision dec <img> <msg_len> \n"
+            "clearvision batch <operation> <op args> <files|dirs|@list> [--decoders N] [--workers N] [--encoders N] [--queue N]\n"
+            "clearvision sweep mean <img> <sizes> | gauss <img> <sizes> <sigmas> | unsharp <img> <sizes> <amounts> [--workers N] (lists like 3,11,19)\n"
+            "mean, gauss, unsharp, median, conv, add, sub, equals and reveal accept --roi x,y,w,h to work on a region only\n"
+            "--profile (or CLEARVISION_PROFILE=1) prints time, IPC and cache/branch misses per pixel of the hot loops"
         );
     }
 
     std::string operation = argv[1];
 
     try {
+        // Strip --roi x,y,w,h and --profile from the arguments so the positional arguments stay in place
+        RegionOfInterest roi;
+        const char* profile_variable = std::getenv("CLEARVISION_PROFILE");
+        if (profile_variable != nullptr && std::string(profile_variable) != "0") {
+            Profiler::enable();
+        }
+        std::vector<char*> positional;
+        for (int i = 0; i < argc; i++) {
+            if (std::string(argv[i]) == "--roi") {
+                if (i + 1 >= argc) throw std::invalid_argument("Missing value for --roi");
+                roi = parse_roi(argv[++i]);
+            } else if (std::string(argv[i]) == "--profile") {
+                Profiler::enable();
+            } else {
+                positional.push_back(argv[i]);
+            }
+        }
+        // Only these operations know how to work on a region, every other one would silently process the whole image
+        const std::vector<std::string> region_operations = { "mean", "gauss", "unsharp", "median", "conv", "add", "sub", "equals", "reveal" };
+        if (roi.set && std::find(region_operations.begin(), region_operations.end(), operation) == region_operations.end()) {
+            throw std::invalid_argument("--roi is not supported by " + operation);
+        }
+        argc = (int)positional.size();
+        argv = positional.data();
+
         // Parse and execute the specified operation
         if (operation == "mean") {
             if (argc < 4) throw std::invalid_argument("Usage: clearvision mean <img> <kernel_size>");
-            apply_mean_filter(argv[2], std::stoi(argv[3]));
+            apply_mean_filter(argv[2], std::stoi(argv[3]), roi);
 
         } else if (operation == "gauss") {
             if (argc < 5) throw std::invalid_argument("Usage: clearvision gauss <img> <kernel_size> <sigma>");
-            apply_gaussian_smoothing(argv[2], std::stoi(argv[3]), std::stof(argv[4]));
+            apply_gaussian_smoothing(argv[2], std::stoi(argv[3]), std::stof(argv[4]), roi);
 
         } else if (operation == "unsharp") {
             if (argc < 5) throw std::invalid_argument("Usage: clearvision unsharp <img> <kernel_size> <amount>");
-            apply_unsharp_mask(argv[2], std::stoi(argv[3]), std::stof(argv[4]));
+            apply_unsharp_mask(argv[2], std::stoi(argv[3]), std::stof(argv[4]), roi);
+
+        } else if (operation == "gauss_pyr") {
+            if (argc < 6) throw std::invalid_argument("Usage: clearvision gauss_pyr <img> <kernel_size> <sigma> <levels> [--error]");
+            apply_multiscale_filter(argv[2], "gauss", std::stoi(argv[3]), std::stof(argv[4]), std::stoi(argv[5]), argc > 6 && std::string(argv[6]) == "--error");
+
+        } else if (operation == "mean_pyr") {
+            if (argc < 5) throw std::invalid_argument("Usage: clearvision mean_pyr <img> <kernel_size> <levels> [--error]");
+            apply_multiscale_filter(argv[2], "mean", std::stoi(argv[3]), 0, std::stoi(argv[4]), argc > 5 && std::string(argv[5]) == "--error");
+
+        } else if (operation == "conv") {
+            if (argc < 4) throw std::invalid_argument("Usage: clearvision conv <img> <kernel_file> [auto|direct|separable|box|fft]");
+            apply_convolution(argv[2], argv[3], argc > 4 ? argv[4] : "auto", roi);
+
+        } else if (operation == "tune") {
+            std::string profile = argc > 2 ? argv[2] : Tuning::profile_path();
+            Tuning::tune(profile);
+            std::cout << "Tuning profile written to " << profile << std::endl;
+
+        } else if (operation == "median") {
+            if (argc < 4) throw std::invalid_argument("Usage: clearvision median <img> <kernel_size>");
+            apply_median_filter(argv[2], std::stoi(argv[3]), roi);
+
+        } else if (operation == "bilateral") {
+            if (argc < 5) throw std::invalid_argument("Usage: clearvision bilateral <img> <spatial_sigma> <range_sigma>");
+            apply_bilateral_filter(argv[2], std::stof(argv[3]), std::stof(argv[4]));
+
+        } else if (operation == "erode" || operation == "dilate" || operation == "open" || operation == "close" || operation == "gradient") {
+            if (argc < 4) throw std::invalid_argument("Usage: clearvision " + operation + " <img> <width> [height]");
+            int element_width = std::stoi(argv[3]);
+            apply_morphology(argv[2], operation, element_width, argc > 4 ? std::stoi(argv[4]) : element_width);
 
         } else if (operation == "add") {
             if (argc < 4) throw std::invalid_argument("Usage: clearvision add <img1> <img2>"); // argc < 4
-            add_images(argv[2], argv[3]);
+            add_images(argv[2], argv[3], roi);
 
         } else if (operation == "sub") {
             if (argc < 4) throw std::invalid_argument("Usage: clearvision sub <img1> <img2>");
-            subtract_images(argv[2], argv[3]);
+            subtract_images(argv[2], argv[3], roi);
 
         } else if (operation == "equals") {
             if (argc < 4) throw std::invalid_argument("Usage: clearvision equals <img1> <img2>");
-            compare_images(argv[2], argv[3]);
+            compare_images(argv[2], argv[3], roi);
 
         } else if (operation == "disguise") {
-            if (argc < 3) throw std::invalid_argument("Usage: clearvision disguise <img>");
-            disguise_image(argv[2]);
+            if (argc < 3) throw std::invalid_argument("Usage: clearvision disguise <img> [--compress]");
+            disguise_image(argv[2], argc > 3 && std::string(argv[3]) == "--compress");
 
         } else if (operation == "reveal") {
-            if (argc < 3) throw std::invalid_argument("Usage: clearvision reveal <dat>");
-            reveal_image(argv[2]);
+            if (argc < 3) throw std::invalid_argument("Usage: clearvision reveal <dat> [--roi x,y,w,h]");
+            reveal_image(argv[2], roi);
 
         } else if (operation == "enc") {
             if (argc < 4) throw std::invalid_argument("Usage: clearvision enc <img> <message>");
@@ -155,13 +412,23 @@ int main(int argc, char** argv) {
             if (argc < 4) throw std::invalid_argument("Usage: clearvision dec <img> <msg_len>");
             decrypt_image(argv[2], std::stoi(argv[3]));
 
+        } else if (operation == "batch") {
+            if (argc < 4) throw std::invalid_argument("Usage: clearvision batch <operation> <op args> <files|dirs|@list>");
+            batch_process(argc - 2, argv + 2);
+
+        } else if (operation == "sweep") {
+            if (argc < 5) throw std::invalid_argument("Usage: clearvision sweep <operation> <img> <lists>");
+            sweep_process(argc - 2, argv + 2);
+
         } else {
             throw std::invalid_argument("Invalid operation.");
         }
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
+        Profiler::report(std::cerr);
         return 1;
     }
+    Profiler::report(std::cerr);
 
     return 0;
 }
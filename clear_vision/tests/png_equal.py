@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+"""Compares the pixels of two 8-bit PNG files without going through clearvision.
+
+Used by run_golden.sh as an oracle that doesn't depend on the binary under test.
+Both images are reduced to gray levels the way clearvision loads them (stb_image's
+integer luma, alpha dropped), so a colour golden matches its grayscale rendering.
+Exits 0 when the pixels are equal, 1 when they differ and 2 when a file can't be decoded.
+
+Usage: png_equal.py <a.png> <b.png>
+"""
+
+import struct
+import sys
+import zlib
+
+CHANNELS = {0: 1, 2: 3, 4: 2, 6: 4}
+
+
+def decode(path):
+    """Returns (width, height, channels, rows) of a non-interlaced 8-bit PNG."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:8] != b"\x89PNG\r\n\x1a\n":
+        raise ValueError("not a PNG file")
+    position, idat, header = 8, [], None
+    while position < len(data):
+        length, kind = struct.unpack(">I4s", data[position:position + 8])
+        body = data[position + 8:position + 8 + length]
+        position += 12 + length
+        if kind == b"IHDR":
+            header = struct.unpack(">IIBBBBB", body)
+        elif kind == b"IDAT":
+            idat.append(body)
+        elif kind == b"IEND":
+            break
+    if header is None:
+        raise ValueError("missing IHDR")
+    width, height, depth, colour, _, _, interlace = header
+    if depth != 8 or colour not in CHANNELS or interlace != 0:
+        raise ValueError("only 8-bit non-interlaced PNGs are supported")
+    channels = CHANNELS[colour]
+    raw = zlib.decompress(b"".join(idat))
+    stride = width * channels
+    rows, previous = [], bytearray(stride)
+    for y in range(height):
+        start = y * (stride + 1)
+        kind, line = raw[start], bytearray(raw[start + 1:start + 1 + stride])
+        for x in range(stride):
+            left = line[x - channels] if x >= channels else 0
+            up = previous[x]
+            corner = previous[x - channels] if x >= channels else 0
+            if kind == 1:
+                line[x] = (line[x] + left) & 0xFF
+            elif kind == 2:
+                line[x] = (line[x] + up) & 0xFF
+            elif kind == 3:
+                line[x] = (line[x] + (left + up) // 2) & 0xFF
+            elif kind == 4:
+                estimate = left + up - corner
+                pa, pb, pc = abs(estimate - left), abs(estimate - up), abs(estimate - corner)
+                predictor = left if pa <= pb and pa <= pc else (up if pb <= pc else corner)
+                line[x] = (line[x] + predictor) & 0xFF
+            elif kind != 0:
+                raise ValueError("unknown filter type %d" % kind)
+        rows.append(bytes(line))
+        previous = line
+    return width, height, channels, rows
+
+
+def gray(image):
+    """Gray levels of a decoded image, (77 r + 150 g + 29 b) >> 8 for colour like stb_image."""
+    width, height, channels, rows = image
+    if channels <= 2:
+        return width, height, [bytes(row[::channels]) for row in rows]
+    return width, height, [bytes((77 * row[x] + 150 * row[x + 1] + 29 * row[x + 2]) >> 8
+                                 for x in range(0, len(row), channels)) for row in rows]
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__.strip().splitlines()[-1], file=sys.stderr)
+        return 2
+    try:
+        first, second = gray(decode(sys.argv[1])), gray(decode(sys.argv[2]))
+    except (OSError, ValueError, zlib.error) as error:
+        print("Can't decode: %s" % error, file=sys.stderr)
+        return 2
+    return 0 if first == second else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
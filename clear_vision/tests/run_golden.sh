@@ -0,0 +1,264 @@
+#!/usr/bin/env bash
+# Golden output and performance regression checks over sample_io.
+#
+# Every case runs one clearvision operation on the sample inputs, compares the
+# result bit for bit against the expected output stored next to them and times
+# the run. PNG pixels are compared by tests/png_equal.py (python3), so a broken
+# "equals" in the binary can't hide a wrong result; "equals" has cases of its own. A case fails when its output differs or when it is more than
+# SLOWDOWN times slower than the stored baseline. Very short cases may also
+# exceed their baseline by NOISE seconds, so timer jitter alone can't fail them.
+# Without a baseline the timings can't be checked and the run fails, unless
+# TIMING=0 asks for the output checks only.
+#
+# Usage: run_golden.sh <clearvision binary> [--update-baseline]
+#   SLOWDOWN  allowed slowdown factor against the baseline (default 1.25)
+#   NOISE     absolute slack in seconds for short cases (default 0.005)
+#   REPEAT    runs per case, the fastest one is timed (default 7)
+#   BASELINE  baseline file (default tests/perf_baseline.txt)
+#   TIMING    0 skips the timing comparison (default 1)
+
+set -u
+
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 <clearvision binary> [--update-baseline]" >&2
+    exit 2
+fi
+
+here=$(cd "$(dirname "$0")" && pwd)
+bin="$(cd "$(dirname "$1")" && pwd)/$(basename "$1")"
+update_baseline=0
+[ "${2:-}" = "--update-baseline" ] && update_baseline=1
+
+samples="$here/../sample_io"
+slowdown=${SLOWDOWN:-1.25}
+repeat=${REPEAT:-7}
+baseline=${BASELINE:-$here/perf_baseline.txt}
+noise=${NOISE:-0.005}
+timing=${TIMING:-1}
+[ "$update_baseline" -eq 1 ] && timing=0
+
+if [ "$timing" -ne 0 ] && [ ! -f "$baseline" ]; then
+    echo "*** No performance baseline at $baseline: timings can't be checked." >&2
+    echo "*** Record one with 'make baseline' or run with TIMING=0 for the output checks only." >&2
+    missing_baseline=1
+else
+    missing_baseline=0
+fi
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+failures=0
+timings=""
+
+# Seconds taken by the fastest of $repeat runs of the command, output goes to case.log.
+# The expected output files (comma separated) are removed before every run so a stale copy never passes.
+time_runs() {
+    local outputs=$1 best="" start end elapsed
+    shift
+    for ((run = 0; run < repeat; run++)); do
+        rm -f ${outputs//,/ }
+        start=$(date +%s%N)
+        "$@" > case.log 2>&1 || { echo "FAILED"; return; }
+        end=$(date +%s%N)
+        elapsed=$(( end - start ))
+        if [ -z "$best" ] || [ "$elapsed" -lt "$best" ]; then
+            best=$elapsed
+        fi
+    done
+    awk -v ns="$best" 'BEGIN { printf "%.4f", ns / 1e9 }'
+}
+
+# Baseline seconds of a case, empty when it has none
+baseline_of() {
+    [ -f "$baseline" ] && awk -v name="$1" '$1 == name { print $2 }' "$baseline"
+}
+
+# run_case <name> <sample dir> <outputs> <goldens> <operation args...>
+# Operations writing several files give comma separated outputs and goldens in the same order.
+run_case() {
+    local name=$1 dir=$2 output_list=$3 golden_list=$4
+    shift 4
+    local case_dir="$work/$name"
+    mkdir -p "$case_dir"
+    cp "$samples/$dir"/* "$case_dir"/
+    pushd "$case_dir" > /dev/null
+
+    local seconds status="ok" detail=""
+    seconds=$(time_runs "$output_list" "$bin" "$@")
+    if [ "$seconds" = "FAILED" ]; then
+        status="FAIL"
+        detail="command failed: $(head -n 1 case.log)"
+    else
+        local outputs goldens i output golden expected
+        IFS=, read -r -a outputs <<< "$output_list"
+        IFS=, read -r -a goldens <<< "$golden_list"
+        for ((i = 0; i < ${#goldens[@]}; i++)); do
+            output=${outputs[$i]} golden=${goldens[$i]} expected="$samples/$dir/${goldens[$i]}"
+            if [[ "$golden" == message:* ]]; then
+                grep -qxF "Decrypted Message: ${golden#message:}" case.log || { status="FAIL"; detail="wrong message"; }
+            elif [ "${golden##*.}" = "png" ]; then
+                # Pixels are compared by an independent decoder, not by the binary under test
+                python3 "$here/png_equal.py" "$output" "$expected" || { status="FAIL"; detail="$output differs from $golden"; }
+            else
+                cmp -s "$output" "$expected" || { status="FAIL"; detail="$output differs from $golden"; }
+            fi
+            [ "$status" = "ok" ] || break
+        done
+    fi
+
+    if [ "$status" = "ok" ]; then
+        timings="$timings$name $seconds"$'\n'
+        local reference
+        reference=$(baseline_of "$name")
+        if [ "$timing" -ne 0 ] && [ "$missing_baseline" -eq 0 ]; then
+            if [ -z "$reference" ]; then
+                status="NOBASE"
+                detail="no baseline entry, run 'make baseline'"
+            elif awk -v t="$seconds" -v b="$reference" -v f="$slowdown" -v n="$noise" \
+                    'BEGIN { limit = b * f; if (limit < b + n) limit = b + n; exit !(t > limit) }'; then
+                status="SLOW"
+                detail="${seconds}s vs baseline ${reference}s (limit x$slowdown, at least +${noise}s)"
+            fi
+        fi
+    fi
+
+    printf "%-20s %-6s %8ss %s\n" "$name" "$status" "$seconds" "$detail"
+    [ "$status" = "ok" ] || failures=$((failures + 1))
+    popd > /dev/null
+}
+
+# compressed_case <name> <sample dir> <image> <golden> [reveal options...]
+# disguise --compress, then reveal the compressed file; the revealed pixels must equal the golden
+compressed_case() {
+    local name=$1 dir=$2 image=$3 golden=$4
+    shift 4
+    local case_dir="$work/$name" status="ok" detail="" secret="secret_image_${image%.*}.dat"
+    mkdir -p "$case_dir"
+    cp "$samples/$dir"/* "$case_dir"/
+    pushd "$case_dir" > /dev/null
+    rm -f "$secret" "reconstructed_${secret%.dat}.png"
+    if ! "$bin" disguise "$image" --compress > case.log 2>&1; then
+        status="FAIL"
+        detail="disguise failed: $(head -n 1 case.log)"
+    elif [ "$(head -c 8 "$secret")" != "CVSECRET" ]; then
+        status="FAIL"
+        detail="$secret is not in the compressed format"
+    elif ! "$bin" reveal "$secret" "$@" > case.log 2>&1; then
+        status="FAIL"
+        detail="reveal failed: $(head -n 1 case.log)"
+    elif ! python3 "$here/png_equal.py" "reconstructed_${secret%.dat}.png" "$samples/$dir/$golden"; then
+        status="FAIL"
+        detail="revealed image differs from $golden"
+    fi
+    printf "%-20s %-6s %9s %s\n" "$name" "$status" "-" "$detail"
+    [ "$status" = "ok" ] || failures=$((failures + 1))
+    popd > /dev/null
+}
+
+# expect_output <name> <sample dir> <expected line> <operation args...>
+# The operation must succeed and print the line
+expect_output() {
+    local name=$1 dir=$2 line=$3
+    shift 3
+    local case_dir="$work/$name" status="ok" detail=""
+    mkdir -p "$case_dir"
+    cp "$samples/$dir"/* "$case_dir"/
+    pushd "$case_dir" > /dev/null
+    if ! "$bin" "$@" > case.log 2>&1; then
+        status="FAIL"
+        detail="command failed: $(head -n 1 case.log)"
+    elif ! grep -qxF "$line" case.log; then
+        status="FAIL"
+        detail="expected \"$line\", got: $(head -n 1 case.log)"
+    fi
+    printf "%-20s %-6s %9s %s\n" "$name" "$status" "-" "$detail"
+    [ "$status" = "ok" ] || failures=$((failures + 1))
+    popd > /dev/null
+}
+
+# expect_error <name> <sample dir> <expected message> <operation args...>
+# The operation must fail and report the message
+expect_error() {
+    local name=$1 dir=$2 message=$3
+    shift 3
+    local case_dir="$work/$name" status="ok" detail=""
+    mkdir -p "$case_dir"
+    cp "$samples/$dir"/* "$case_dir"/
+    pushd "$case_dir" > /dev/null
+    if "$bin" "$@" > case.log 2>&1; then
+        status="FAIL"
+        detail="command succeeded"
+    elif ! grep -qF "$message" case.log; then
+        status="FAIL"
+        detail="expected \"$message\", got: $(head -n 1 case.log)"
+    fi
+    printf "%-20s %-6s %9s %s\n" "$name" "$status" "-" "$detail"
+    [ "$status" = "ok" ] || failures=$((failures + 1))
+    popd > /dev/null
+}
+
+message=$(cat "$samples/secret message encrpytion/secret_message.txt")
+
+run_case mean_3        mean        mean_filtered_creep_3.png                   mean_filtered_creep_3x3.png          mean creep.jpg 3
+run_case mean_11       mean        mean_filtered_creep_11.png                  mean_filtered_creep_11x11.png        mean creep.jpg 11
+run_case mean_19       mean        mean_filtered_creep_19.png                  mean_filtered_creep_19x19.png        mean creep.jpg 19
+run_case gauss_21_2    gauss       gaussian_filtered_puppy_21_2.000000.png     gaussian_filtered_puppy_21x21_2.png  gauss puppy.png 21 2
+run_case gauss_21_4    gauss       gaussian_filtered_puppy_21_4.000000.png     gaussian_filtered_puppy_21x21_4.png  gauss puppy.png 21 4
+run_case gauss_41_2    gauss       gaussian_filtered_puppy_41_2.000000.png     gaussian_filtered_puppy_41x41_2.png  gauss puppy.png 41 2
+run_case gauss_41_4    gauss       gaussian_filtered_puppy_41_4.000000.png     gaussian_filtered_puppy_41x41_4.png  gauss puppy.png 41 4
+run_case gauss_large   large       gaussian_filtered_puppy_large_21_4.000000.png gaussian_filtered_puppy_large_21x21_4.png gauss puppy_large.png 21 4
+run_case unsharp_9_1   unsharp     unsharp_filtered_flowers_9_1.000000.png     unsharp_filtered_flowers_9x9_1.png   unsharp flowers.png 9 1
+run_case unsharp_9_5   unsharp     unsharp_filtered_flowers_9_5.000000.png     unsharp_filtered_flowers_9x9_5.png   unsharp flowers.png 9 5
+run_case unsharp_9_10  unsharp     unsharp_filtered_flowers_9_10.000000.png    unsharp_filtered_flowers_9x9_10.png  unsharp flowers.png 9 10
+run_case sweep_mean    mean        mean_filtered_creep_3.png,mean_filtered_creep_11.png,mean_filtered_creep_19.png \
+                                   mean_filtered_creep_3x3.png,mean_filtered_creep_11x11.png,mean_filtered_creep_19x19.png \
+                                   sweep mean creep.jpg 3,11,19
+run_case sweep_unsharp unsharp     unsharp_filtered_flowers_9_1.000000.png,unsharp_filtered_flowers_9_5.000000.png,unsharp_filtered_flowers_9_10.000000.png \
+                                   unsharp_filtered_flowers_9x9_1.png,unsharp_filtered_flowers_9x9_5.png,unsharp_filtered_flowers_9x9_10.png \
+                                   sweep unsharp flowers.png 9 1,5,10
+run_case median_3      median      median_filtered_flowers_3.png               median_filtered_flowers_3x3.png      median flowers.png 3
+run_case median_4      median      median_filtered_flowers_4.png               median_filtered_flowers_4x4.png      median flowers.png 4
+run_case median_9      median      median_filtered_flowers_9.png               median_filtered_flowers_9x9.png      median flowers.png 9
+# Odd and even structuring elements, the even one is off centre
+for operation in erode dilate open close gradient; do
+    run_case ${operation}_5x3 morphology ${operation}_filtered_flowers_5x3.png ${operation}_flowers_5x3.png $operation flowers.png 5 3
+    run_case ${operation}_4x4 morphology ${operation}_filtered_flowers_4x4.png ${operation}_flowers_4x4.png $operation flowers.png 4
+done
+# Every strategy must give the same pixels on one kernel file
+for strategy in direct separable box fft; do
+    run_case conv_box_$strategy conv convolved_flowers_box5.png convolved_flowers_box_5x5.png conv flowers.png box5.txt $strategy
+done
+for strategy in direct separable fft; do
+    run_case conv_binom_$strategy conv convolved_flowers_binomial5.png convolved_flowers_binomial_5x5.png conv flowers.png binomial5.txt $strategy
+done
+run_case add           addition    added_image1_image2.png                     added_image1_image2.png              add image1.png image2.png
+run_case sub           subtraction subtracted_image1_image2.png                subtracted_image1_image2.png         sub image1.png image2.png
+run_case disguise      disguise-reveal secret_image_flowers.dat                secret_image_flowers.dat             disguise flowers.png
+run_case reveal        disguise-reveal reconstructed_secret_image_flowers.png  flowers.png                          reveal secret_image_flowers.dat
+run_case reveal_roi    disguise-reveal reconstructed_secret_image_flowers.png  flowers_region_40_30_120_90.png      reveal secret_image_flowers.dat --roi 40,30,120,90
+run_case enc           "secret message encrpytion" modified_secret_image_puppy.png puppy_with_secret_message_embedded.png enc puppy.png "$message"
+run_case dec           "secret message encrpytion" - "message:$message"    dec puppy_with_secret_message_embedded.png "${#message}"
+
+compressed_case compressed     disguise-reveal flowers.png flowers.png
+compressed_case compressed_roi disguise-reveal flowers.png flowers_region_40_30_120_90.png --roi 40,30,120,90
+expect_output  equals_same   addition "Images are equal."     equals image1.png image1.png
+expect_output  equals_differ addition "Images are not equal." equals image1.png image2.png
+expect_output  equals_roi    addition "Images are not equal." equals image1.png image2.png --roi 10,10,50,50
+expect_error   roi_empty_w median      "Region of interest must not be empty."      median flowers.png 5 --roi 5,5,0,4
+expect_error   roi_empty_h unsharp     "Region of interest must not be empty."      unsharp flowers.png 9 1 --roi 5,5,4,0
+expect_error   roi_outside median      "Region of interest lies outside the image." median flowers.png 5 --roi 290,5,20,4
+
+if [ "$update_baseline" -eq 1 ] && [ "$failures" -eq 0 ]; then
+    printf "%s" "$timings" > "$baseline"
+    echo "Baseline written to $baseline"
+elif [ "$missing_baseline" -eq 1 ]; then
+    echo "*** No performance baseline, timings were not compared (run 'make baseline')." >&2
+    failures=$((failures + 1))
+fi
+
+if [ "$failures" -ne 0 ]; then
+    echo "$failures case(s) failed."
+    exit 1
+fi
+echo "All cases passed."